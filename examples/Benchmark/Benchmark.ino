@@ -0,0 +1,152 @@
+/*
+ * AvantPinSet Benchmark Example
+ *
+ * Description:
+ * This sketch measures what the library costs on the device. It times update(),
+ * getHandle(), systemStatus() and pinStatus() with the ESP32 cycle counter for
+ * 1, 8, 16 and 32 managed pins, with no timers, with every pin waiting on a timer,
+ * and with every pin fading. For each case it prints the min/avg/max cycles per
+ * call and the heap delta per call, so regressions show up between library versions.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ * Date: October 14, 2026
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32, ESP32-S2, ESP32-S3, ESP32-C3, ESP32-C6 or ESP32-H2 (other chips need their own safePins list)
+ * - Nothing has to be connected, but the pins listed in safePins are driven as
+ *   outputs, so disconnect anything that must not be toggled
+ *
+ * Dependencies:
+ * - AvantPinSet Library (AvantPinSet.h, AvantPinSet.cpp)
+ *
+ * Usage Notes:
+ * 1. Upload to your ESP32 and open the Serial Monitor at 115200 baud.
+ * 2. Pin counts above the number of entries in safePins are made up with virtual pins
+ *    (see attachDriver()) that have no driver: the library schedules and fades them like
+ *    GPIOs but writes no hardware, so those cases slightly understate the write cost.
+ * 3. To also see the library's internal timing (including single fade steps),
+ *    build with -DAVANT_PINSET_PROFILING in the build flags, e.g. in PlatformIO:
+ *      build_flags = -DAVANT_PINSET_PROFILING
+ *    The define has to reach the library sources, so defining it in this sketch is not enough.
+ *
+ */
+
+#include <AvantPinSet.h>
+
+// Outputs that are safe to toggle on a bare dev board: no flash, PSRAM, USB or UART0 pins,
+// and no strapping pins that a board ties to a button
+#if defined(CONFIG_IDF_TARGET_ESP32)
+const int safePins[] = {2, 4, 5, 12, 13, 14, 15, 16, 17, 18, 19, 21, 22, 23, 25, 26, 27, 32, 33};
+#elif defined(CONFIG_IDF_TARGET_ESP32S2)
+const int safePins[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 21, 33, 34, 35, 36, 37, 38};
+#elif defined(CONFIG_IDF_TARGET_ESP32S3)
+const int safePins[] = {1, 2, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 21, 38, 39, 40, 41, 42, 47, 48};
+#elif defined(CONFIG_IDF_TARGET_ESP32C3)
+const int safePins[] = {0, 1, 3, 4, 5, 6, 7, 10};
+#elif defined(CONFIG_IDF_TARGET_ESP32C6)
+const int safePins[] = {0, 1, 2, 3, 4, 5, 6, 7, 10, 11, 18, 19, 20, 21, 22, 23};
+#elif defined(CONFIG_IDF_TARGET_ESP32H2)
+const int safePins[] = {0, 1, 10, 11, 12, 13, 14, 22};
+#else
+#error "No list of safe output pins for this chip yet; add one to safePins"
+#endif
+const int safePinCount = sizeof(safePins) / sizeof(safePins[0]);
+
+const int pinCounts[] = {1, 8, 16, 32};
+const int maxPinCount = 32;
+
+// The safe GPIOs, followed by virtual pins up to maxPinCount (filled in by setup())
+int benchPins[maxPinCount];
+const int iterations = 1000;
+
+// Collects the cycles and heap change of repeated calls
+struct Measurement {
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  int32_t heapDelta;
+};
+
+template <typename Operation>
+Measurement measure(Operation operation) {
+  Measurement m = {UINT32_MAX, 0, 0, 0};
+  uint32_t heapBefore = ESP.getFreeHeap();
+
+  for (int i = 0; i < iterations; i++) {
+    uint32_t start = ESP.getCycleCount();
+    operation();
+    uint32_t cycles = ESP.getCycleCount() - start;
+
+    if (cycles < m.minCycles) m.minCycles = cycles;
+    if (cycles > m.maxCycles) m.maxCycles = cycles;
+    m.totalCycles += cycles;
+  }
+
+  m.heapDelta = (int32_t)heapBefore - (int32_t)ESP.getFreeHeap();
+  return m;
+}
+
+void printMeasurement(int pins, const char* mix, const char* path, const Measurement& m) {
+  Serial.printf("%4d  %-8s  %-22s  %8u  %8u  %8u  %8.2f\n", pins, mix, path, m.minCycles,
+                (uint32_t)(m.totalCycles / iterations), m.maxCycles, (float)m.heapDelta / iterations);
+}
+
+void benchmark(int pins, const char* mix) {
+  AvantPinSet pinSet(benchPins, pins);
+
+  if (strcmp(mix, "timers") == 0) {
+    // Every pin waits on a timer that does not come due during the run
+    for (int i = 0; i < pins; i++) pinSet.digitalSetTime(benchPins[i], HIGH, 3600);
+  } else if (strcmp(mix, "fading") == 0) {
+    // Every pin runs a long fade, so each update() advances all of them
+    for (int i = 0; i < pins; i++) pinSet.pwmFade(benchPins[i], 0, 255, 3600000UL);
+  }
+  delay(2); // Let the first fade step come due
+
+  char buffer[1024];
+  int lastPin = benchPins[pins - 1];
+  PinHandle handle = pinSet.getHandle(lastPin);
+
+  AvantPinSet::resetProfile();
+  printMeasurement(pins, mix, "update()", measure([&]() { pinSet.update(); }));
+  printMeasurement(pins, mix, "getHandle()", measure([&]() { volatile PinHandle h = pinSet.getHandle(lastPin); (void)h; }));
+  printMeasurement(pins, mix, "systemStatus()", measure([&]() { String s = pinSet.systemStatus(); }));
+  printMeasurement(pins, mix, "systemStatus(buffer)", measure([&]() { pinSet.systemStatus(buffer, sizeof(buffer)); }));
+  printMeasurement(pins, mix, "pinStatus(handle,buf)", measure([&]() { pinSet.pinStatus(handle, buffer, sizeof(buffer)); }));
+
+  if (AvantPinSet::profilingEnabled()) {
+    PinSetProfile fade = AvantPinSet::profile(PROFILE_FADE_STEP);
+    if (fade.calls > 0) {
+      Serial.printf("%4d  %-8s  %-22s  %8u  %8u  %8u  (library profile)\n", pins, mix, "fade step", fade.minCycles,
+                    (uint32_t)(fade.totalCycles / fade.calls), fade.maxCycles);
+    }
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("AvantPinSet Benchmark");
+  Serial.printf("CPU: %u MHz, %d iterations per measurement\n\n", getCpuFrequencyMhz(), iterations);
+
+  for (int i = 0; i < maxPinCount; i++) {
+    benchPins[i] = (i < safePinCount) ? safePins[i] : AVANT_PINSET_VIRTUAL_PIN_BASE + i - safePinCount;
+  }
+  if (safePinCount < maxPinCount) {
+    Serial.printf("Pins beyond the %d safe GPIOs on this chip are virtual pins without a driver\n\n", safePinCount);
+  }
+
+  Serial.println("pins  mix       path                         min       avg       max  heap/call");
+
+  const char* mixes[] = {"idle", "timers", "fading"};
+  for (int count : pinCounts) {
+    for (const char* mix : mixes) benchmark(count, mix);
+  }
+
+  Serial.println("\nBenchmark finished.");
+}
+
+void loop() {
+}
@@ -0,0 +1,80 @@
+/*
+ * AvantPinSet Binary Control Example
+ *
+ * Description:
+ * This sketch drives pins through the library's compact binary frame protocol
+ * instead of text commands. Frames received on the serial port are decoded in
+ * place by applyFrames(), which hands them straight to the batch API, and the
+ * sketch answers with a packed binary status of the pins that changed. There
+ * is no String parsing and no JSON, so a gateway can send commands at a high rate.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ * Date: October 14, 2026
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller
+ * - LEDs (with suitable resistors, e.g., 220-330 Ohm) connected to pins 2, 4, 12 and 13
+ *
+ * Dependencies:
+ * - AvantPinSet Library (AvantPinSet.h, AvantPinSet.cpp)
+ *
+ * Usage Notes:
+ * 1. Upload to your ESP32. The serial port runs at 115200 baud and carries binary data,
+ *    so use a program or script rather than the Serial Monitor.
+ * 2. Each frame starts with a PinCommandType opcode and the pin number, followed by
+ *    little-endian fields (see PIN_FRAME_MAX_LENGTH in AvantPinSet.h). For example:
+ *      00 02 01 00              - digitalSet(2, HIGH)
+ *      02 04 80 00              - pwmSet(4, 128)
+ *      05 0C FF 00 00 00 05 00 00 00
+ *                               - pwmFadeTime(12, 255, 0, 5)
+ * 3. After frames have been applied, the sketch replies with the changed pins:
+ *    a count byte, then 4 bytes per pin (pin number, mode, value low, value high).
+ * 4. A byte that is not a known opcode is dropped, so the stream resynchronizes
+ *    at the next frame.
+ *
+ */
+
+#include <AvantPinSet.h>
+
+int myPinList[] = {2, 4, 12, 13};
+const int numPins = 4;
+
+AvantPinSet myPins(myPinList, numPins);
+
+// Received bytes that do not form a complete frame yet
+uint8_t rxBuffer[64];
+size_t rxLength = 0;
+
+// One count byte plus one packed entry per pin
+uint8_t txBuffer[1 + numPins * PIN_PACKED_STATUS_SIZE];
+
+void setup() {
+  Serial.begin(115200);
+}
+
+void loop() {
+  // Collect whatever has arrived, up to the free space in the buffer
+  while (Serial.available() && rxLength < sizeof(rxBuffer)) {
+    rxBuffer[rxLength++] = (uint8_t)Serial.read();
+  }
+
+  if (rxLength > 0) {
+    size_t consumed = myPins.applyFrames(rxBuffer, rxLength);
+
+    // Drop a byte that cannot start a frame, so one bad byte does not block the stream
+    if (consumed < rxLength && AvantPinSet::frameLength(rxBuffer[consumed]) == 0) consumed++;
+
+    // Keep a frame that is cut off for the next round
+    memmove(rxBuffer, rxBuffer + consumed, rxLength - consumed);
+    rxLength -= consumed;
+  }
+
+  // Report the pins that changed, including timers and fades that completed
+  myPins.update();
+  if (myPins.hasChanges()) {
+    size_t length = myPins.packedStatusDelta(txBuffer, sizeof(txBuffer));
+    Serial.write(txBuffer, length);
+  }
+}
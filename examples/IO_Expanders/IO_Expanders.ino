@@ -0,0 +1,96 @@
+/*
+ * AvantPinSet IO Expanders Example
+ *
+ * Description:
+ * This sketch drives the outputs of a PCA9685 PWM controller and an MCP23017 GPIO
+ * expander as virtual pins of one AvantPinSet, next to a native GPIO. The virtual
+ * pins use the same API as GPIOs: the PCA9685 channels run staggered fades and the
+ * MCP23017 outputs blink on timers. Everything that changes during one update() is
+ * sent to each device in a single I2C transaction.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ * Date: October 14, 2026
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller
+ * - A PCA9685 board at I2C address 0x40 with LEDs on channels 0-3
+ * - An MCP23017 at I2C address 0x20 with LEDs on GPA0 and GPA1
+ * - An LED on pin 2 (most dev boards have one)
+ * - SDA and SCL on the ESP32's default I2C pins (21 and 22 on the ESP32)
+ *
+ * Dependencies:
+ * - AvantPinSet Library (AvantPinSet.h, AvantPinSet.cpp, AvantPinSetExpanders.h)
+ *
+ * Usage Notes:
+ * 1. Upload to your ESP32 and open the Serial Monitor at 115200 baud.
+ * 2. Virtual pins are numbered from AVANT_PINSET_VIRTUAL_PIN_BASE (100). Here the
+ *    PCA9685 channels are pins 100-115 and the MCP23017 outputs are pins 120-135.
+ * 3. The MCP23017 can only switch its outputs; PWM values of 128 and above turn them on.
+ *
+ */
+
+#include <Wire.h>
+#include <AvantPinSet.h>
+#include <AvantPinSetExpanders.h>
+
+const int PCA_FIRST_PIN = AVANT_PINSET_VIRTUAL_PIN_BASE;      // Pins 100-115
+const int MCP_FIRST_PIN = AVANT_PINSET_VIRTUAL_PIN_BASE + 20; // Pins 120-135
+
+int myPinList[] = {2, PCA_FIRST_PIN, PCA_FIRST_PIN + 1, PCA_FIRST_PIN + 2, PCA_FIRST_PIN + 3, MCP_FIRST_PIN, MCP_FIRST_PIN + 1};
+const int numPins = sizeof(myPinList) / sizeof(myPinList[0]);
+
+AvantPinSet myPins(myPinList, numPins);
+
+PCA9685Driver pwmDriver(0x40, 1000);
+MCP23017Driver gpioDriver(0x20);
+
+// Breathing pattern for the PCA9685 channels: fade up, fade down, short pause
+static const PinKeyframe breathing[] = {
+  {255, 1500, FADE_CIE},
+  {0,   1500, FADE_CIE},
+  {0,    500, KEYFRAME_STEP}
+};
+
+// Blink periods of the MCP23017 outputs and pin 2 (milliseconds), and their next level
+const int blinkPins[] = {MCP_FIRST_PIN, MCP_FIRST_PIN + 1, 2};
+const unsigned long blinkPeriods[] = {500, 250, 1000};
+int blinkLevels[] = {HIGH, HIGH, HIGH};
+
+// Switches a blinking pin and times the next switch; runs again as the timer's callback
+void blink(int pinNum) {
+  for (int i = 0; i < 3; i++) {
+    if (blinkPins[i] != pinNum) continue;
+    myPins.digitalSet(pinNum, blinkLevels[i]);
+    blinkLevels[i] = (blinkLevels[i] == HIGH) ? LOW : HIGH;
+    myPins.digitalSetTimeMs(pinNum, blinkLevels[i], blinkPeriods[i], blink);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  Wire.begin();
+  Wire.setClock(400000);
+
+  if (!myPins.attachDriver(pwmDriver, PCA_FIRST_PIN)) Serial.println("PCA9685 not found");
+  if (!myPins.attachDriver(gpioDriver, MCP_FIRST_PIN)) Serial.println("MCP23017 not found");
+
+  // The PCA9685 channels breathe forever, each started 375 ms after the previous one
+  for (int i = 0; i < 4; i++) {
+    myPins.pwmSequence(PCA_FIRST_PIN + i, breathing, 3);
+    delay(375);
+  }
+
+  // The MCP23017 outputs blink with timers, like pin 2
+  for (int i = 0; i < 3; i++) blink(blinkPins[i]);
+}
+
+void loop() {
+  // All writes to a device during this call go out in one I2C transaction
+  myPins.update();
+
+  if (myPins.hasChanges()) {
+    Serial.println(myPins.statusDelta());
+  }
+}
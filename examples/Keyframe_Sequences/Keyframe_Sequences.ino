@@ -0,0 +1,76 @@
+/*
+ * AvantPinSet Keyframe Sequences Example
+ *
+ * Description:
+ * This sketch runs three LED patterns at the same time using pwmSequence():
+ * a breathing effect, a heartbeat and a strobe. Each pattern is a small
+ * constant array of keyframes, so no callbacks are needed to chain the steps.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ * Date: October 14, 2026
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller
+ * - LEDs (with suitable resistors, e.g., 220-330 Ohm) connected to pins 2, 4 and 27
+ *
+ * Dependencies:
+ * - AvantPinSet Library (AvantPinSet.h, AvantPinSet.cpp)
+ *
+ * Usage Notes:
+ * 1. Upload to your ESP32.
+ * 2. Open the Serial Monitor at 115200 baud.
+ * 3. Pin 2 breathes and pin 4 beats like a heart, both forever. Pin 27 strobes
+ *    ten times, then the callback reports that the sequence is complete.
+ *
+ */
+
+#include <AvantPinSet.h>
+
+int myPinList[] = {2, 4, 27};
+const int numPins = 3;
+
+AvantPinSet myPins(myPinList, numPins);
+
+// --- Patterns ---
+// Each keyframe is {value, time in ms, curve}. A FadeCurve fades to the value,
+// KEYFRAME_STEP jumps to it and holds it for the given time.
+static const PinKeyframe breathing[] = {
+  {255, 1500, FADE_CIE},
+  {0,   1500, FADE_CIE},
+  {0,    500, KEYFRAME_STEP}
+};
+
+static const PinKeyframe heartbeat[] = {
+  {255,  80, KEYFRAME_STEP},
+  {0,   120, KEYFRAME_STEP},
+  {255,  80, KEYFRAME_STEP},
+  {0,   720, KEYFRAME_STEP}
+};
+
+static const PinKeyframe strobe[] = {
+  {255,  50, KEYFRAME_STEP},
+  {0,   150, KEYFRAME_STEP}
+};
+
+void strobeComplete(int pinNum) {
+  Serial.print(">>> Callback: Strobe on pin ");
+  Serial.print(pinNum);
+  Serial.println(" has completed!");
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("AvantPinSet Keyframe Sequences Starting...");
+
+  myPins.pwmSequence(2, breathing, 3);                     // Loop forever
+  myPins.pwmSequence(4, heartbeat, 4);                     // Loop forever
+  myPins.pwmSequence(27, strobe, 2, 10, strobeComplete);   // Ten flashes, then stop
+}
+
+void loop() {
+  // Must be called in every loop iteration to advance the sequences
+  myPins.update();
+}
@@ -0,0 +1,84 @@
+/*
+ * AvantPinSet Low Power Sleep Example
+ *
+ * Description:
+ * This sketch runs a battery-friendly node: a pump relay switches on for one minute
+ * every ten minutes and a status LED flashes briefly every ten seconds. Instead of
+ * spinning update() in loop(), it calls sleepUntilNextEvent(), which spends the time
+ * between actions in ESP32 light sleep with the outputs held at their levels.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ * Date: October 14, 2026
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller
+ * - An LED on pin 2 (most dev boards have one)
+ * - A relay module (or an LED as a stand-in) on pin 4
+ *
+ * Dependencies:
+ * - AvantPinSet Library (AvantPinSet.h, AvantPinSet.cpp)
+ *
+ * Usage Notes:
+ * 1. Upload to your ESP32 and open the Serial Monitor at 115200 baud.
+ * 2. The chip only sleeps while no GPIO outputs a PWM signal; a fade or a dimmed LED
+ *    keeps it awake (it then waits with delay()) until the output is steady again.
+ * 3. The serial port is flushed before sleeping, as light sleep stops the UART clock.
+ *
+ */
+
+#include <AvantPinSet.h>
+
+const int LED_PIN = 2;
+const int PUMP_PIN = 4;
+
+int myPinList[] = {LED_PIN, PUMP_PIN};
+const int numPins = 2;
+
+AvantPinSet myPins(myPinList, numPins);
+
+const unsigned long FLASH_MS = 50;
+const unsigned long FLASH_PERIOD_MS = 10000;
+const unsigned long PUMP_ON_MS = 60000UL;
+const unsigned long PUMP_PERIOD_MS = 600000UL;
+
+// digitalSetTimeMs() sets the pin at once and reverts it after the delay, then runs the
+// callback; each callback starts the next phase, so the patterns repeat forever
+void ledOn(int pinNum);
+
+void ledOff(int pinNum) {
+  myPins.digitalSetTimeMs(pinNum, LOW, FLASH_PERIOD_MS - FLASH_MS, ledOn);
+}
+
+void ledOn(int pinNum) {
+  myPins.digitalSetTimeMs(pinNum, HIGH, FLASH_MS, ledOff);
+}
+
+void pumpOn(int pinNum);
+
+void pumpOff(int pinNum) {
+  Serial.println("Pump off");
+  myPins.digitalSetTimeMs(pinNum, LOW, PUMP_PERIOD_MS - PUMP_ON_MS, pumpOn);
+}
+
+void pumpOn(int pinNum) {
+  Serial.println("Pump on");
+  myPins.digitalSetTimeMs(pinNum, HIGH, PUMP_ON_MS, pumpOff);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  ledOn(LED_PIN);
+  pumpOn(PUMP_PIN);
+}
+
+void loop() {
+  Serial.flush();
+
+  // Sleep until the next action is due and run it, waking at least every 30 s
+  if (!myPins.sleepUntilNextEvent(30000000ULL)) {
+    Serial.println("Stayed awake");
+  }
+}
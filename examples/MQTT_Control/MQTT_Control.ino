@@ -81,13 +81,16 @@ const int pinCount = sizeof(managedPins) / sizeof(managedPins[0]);
 // Create an instance of the AvantPinSet library
 AvantPinSet myPins(managedPins, pinCount);
 
+// Completed timed actions are reported here, and published from loop() rather than inside update()
+QueueHandle_t completionEvents;
+
 
 // --- Function Prototypes ---
 void setup_wifi();
 void callback(char* topic, byte* payload, unsigned int length);
 void reconnect();
 void parseMqttCommand(String cmd);
-void onActionComplete(int pinNum);
+void publishCompletions();
 
 
 void setup() {
@@ -95,6 +98,9 @@ void setup() {
   setup_wifi();
   client.setServer(mqtt_server, mqtt_port);
   client.setCallback(callback);
+
+  completionEvents = xQueueCreate(16, sizeof(PinEvent));
+  myPins.setEventQueue(completionEvents);
 }
 
 void loop() {
@@ -105,6 +111,9 @@ void loop() {
 
   // CRITICAL: This must be called in every loop for timed operations to work.
   myPins.update();
+
+  // Publishing can block on the network, so it happens here, after update() has finished
+  publishCompletions();
 }
 
 /**
@@ -170,13 +179,15 @@ void reconnect() {
 }
 
 /**
- * @brief A callback function passed to the library to be executed on completion of timed actions.
- * @param pinNum The pin number on which the action completed.
+ * @brief Publishes a status message for every timed action the library reported as completed.
  */
-void onActionComplete(int pinNum) {
-    String message = "{\"status\":\"INFO\", \"message\":\"Timed action completed on pin " + String(pinNum) + "\"}";
+void publishCompletions() {
+  PinEvent event;
+  while (xQueueReceive(completionEvents, &event, 0) == pdTRUE) {
+    String message = "{\"status\":\"INFO\", \"message\":\"Timed action completed on pin " + String(event.pinNumber) + "\"}";
     Serial.println(message);
     client.publish(led_status_topic, message.c_str());
+  }
 }
 
 
@@ -214,10 +225,10 @@ void parseMqttCommand(String cmd) {
       unsigned long duration = statePart.substring(secondComma + 1).toInt();
       
       if (state == "on" || state == "high") {
-        myPins.digitalSetTime(pinNum, HIGH, duration, onActionComplete);
+        myPins.digitalSetTime(pinNum, HIGH, duration);
         msg = "{\"status\":\"OK\", \"action\":\"Pin " + String(pinNum) + " will turn HIGH for " + String(duration) + " seconds\"}";
       } else if (state == "off" || state == "low") {
-        myPins.digitalSetTime(pinNum, LOW, duration, onActionComplete);
+        myPins.digitalSetTime(pinNum, LOW, duration);
         msg = "{\"status\":\"OK\", \"action\":\"Pin " + String(pinNum) + " will turn LOW for " + String(duration) + " seconds\"}";
       } else {
         client.publish(led_status_topic, "{\"status\":\"ERROR\", \"message\":\"Invalid state for switch command\"}");
@@ -264,7 +275,7 @@ void parseMqttCommand(String cmd) {
       int pin = args[0];
       int value = args[1];
       int time = args[3];
-      myPins.pwmSetTime(pin, value, time, onActionComplete);
+      myPins.pwmSetTime(pin, value, time);
       msg = "{\"status\":\"OK\", \"action\":\"Set pin " + String(pin) + " PWM to " + String(value) + " for " + String(time) + " seconds\"}";
       client.publish(led_status_topic, msg.c_str());
     } else {
@@ -291,7 +302,7 @@ void parseMqttCommand(String cmd) {
       int pin = args[0];
       int startVal = args[1];
       int endVal = args[2];
-      myPins.pwmFadeTime(pin, startVal, endVal, 2, onActionComplete); // Using a 2-second default fade
+      myPins.pwmFadeTime(pin, startVal, endVal, 2); // Using a 2-second default fade
       msg = "{\"status\":\"OK\", \"action\":\"Set pin " + String(pin) + " to PWM " + String(startVal) + ", hold for 2 seconds, then fade to " + String(endVal) + "\"}";
       client.publish(led_status_topic, msg.c_str());
     } else if (argCount == 4) { // e.g., fade:2,128,0,10
@@ -299,7 +310,7 @@ void parseMqttCommand(String cmd) {
       int startVal = args[1];
       int endVal = args[2];
       int time = args[3];
-      myPins.pwmFadeTime(pin, startVal, endVal, time, onActionComplete);
+      myPins.pwmFadeTime(pin, startVal, endVal, time);
       msg = "{\"status\":\"OK\", \"action\":\"Set pin " + String(pin) + " to PWM " + String(startVal) + ", hold for " + String(time) + " seconds, then fade to " + String(endVal) + "\"}";
       client.publish(led_status_topic, msg.c_str());
     } else {
@@ -308,12 +319,15 @@ void parseMqttCommand(String cmd) {
   } 
   // Handle status commands
   else if (cmdType == "status") {
+    // Format straight into a stack buffer, so frequent status polling does not touch the heap
+    char status[256];
     if (argsStr == "system") {
-      client.publish(led_status_topic, myPins.systemStatus().c_str());
+      myPins.systemStatus(status, sizeof(status));
     } else {
       int pin = argsStr.toInt();
-      client.publish(led_status_topic, myPins.pinStatus(pin).c_str());
+      myPins.pinStatus(pin, status, sizeof(status));
     }
+    client.publish(led_status_topic, status);
   } 
   // Handle unknown commands
   else {
@@ -3,14 +3,15 @@
  *
  * Description:
  * This sketch connects an ESP32 to a WiFi network and an NTP server to get the current time.
- * It allows users to set up 6 time slots, each of which can trigger a pin control command
- * at a specific time. Each time slot can be enabled or disabled, and the commands are in the
- * same format as the MQTT_Combined example.
+ * It sets up 6 scheduled rules, each of which applies a pin control command at a local time
+ * of day or relative to sunset, on selected days of the week. Each rule can be enabled or
+ * disabled. The rules are handed to the library with addRule(), which fires them from its
+ * deadline scheduler, so the sketch does not have to poll the clock.
  *
  * Author: AvantMaker <admin@avantmaker.com>
  * Author Website: https://www.AvantMaker.com
  * Date: September 11, 2025
- * Version: 0.0.1
+ * Version: 0.0.2
  *
  * Hardware Requirements:
  * - ESP32-based microcontroller
@@ -21,24 +22,24 @@
  *
  * Usage Notes:
  * 1. Update WiFi credentials in the code below.
- * 2. Configure your timezone and DST settings.
- * 3. Set up the time slots with desired commands and enable/disable them as needed.
+ * 2. Configure your timezone and DST settings, and your location for the sunset rule.
+ * 3. Set up the rules with the desired commands and enable/disable them as needed.
  * 4. Upload this sketch to your ESP32.
- * 5. Monitor the serial output for time and command execution information.
+ * 5. Monitor the serial output for time and rule information.
  *
- * Time Slot Configuration:
- * Each time slot has the following properties:
- * - enabled: Whether the time slot is active (true/false)
- * - hour: Hour of the day (0-23)
- * - minute: Minute of the hour (0-59)
- * - command: The command to execute (same format as MQTT_Combined)
- * - executedToday: Flag to track if the command has been executed today (internal use)
+ * Rule Configuration:
+ * Each scheduled rule has the following properties:
+ * - enabled: Whether the rule is added to the library (true/false)
+ * - command: The PinCommand to apply, {type, pin, value, value2, time}
+ * - days: The days of the week, e.g. RULE_EVERY_DAY, RULE_WEEKDAYS or RULE_SATURDAY | RULE_SUNDAY
+ * - anchor: RULE_AT_TIME, RULE_AT_SUNRISE or RULE_AT_SUNSET
+ * - minutes: Minutes after midnight for RULE_AT_TIME, otherwise minutes after sunrise/sunset
  *
  * Example commands:
- * - "switch:2,on" (Set pin 2 HIGH)
- * - "switch:2,off" (Set pin 2 LOW)
- * - "pwm:2,128" (Set pin 2 PWM to 128)
- * - "fade:2,0,255,5" (Fade pin 2 from 0 to 255 over 5 seconds)
+ * - {PIN_CMD_DIGITAL_SET, 2, HIGH, 0, 0} (Set pin 2 HIGH)
+ * - {PIN_CMD_DIGITAL_SET, 2, LOW, 0, 0} (Set pin 2 LOW)
+ * - {PIN_CMD_PWM_SET, 2, 128, 0, 0} (Set pin 2 PWM to 128)
+ * - {PIN_CMD_PWM_FADE_TIME, 2, 0, 255, 5} (Set pin 2 PWM to 0, hold for 5 seconds, then fade to 255)
  */
 
 #include <WiFi.h>
@@ -59,6 +60,10 @@ const int timezoneOffset = 8;  // UTC+8 (adjust this value for your timezone)
 // Set useDST to true if you want to observe Daylight Saving Time, false otherwise
 const bool useDST = false;     // Set to true for DST, false for standard time only
 
+// Location used for sunrise/sunset rules (degrees, north and east are positive)
+const float latitude = 31.23;
+const float longitude = 121.47;
+
 // Define the pins you want to manage with the library
 int managedPins[] = {2, 4, 12, 13};
 const int pinCount = sizeof(managedPins) / sizeof(managedPins[0]);
@@ -66,91 +71,51 @@ const int pinCount = sizeof(managedPins) / sizeof(managedPins[0]);
 // Create an instance of the AvantPinSet library
 AvantPinSet myPins(managedPins, pinCount);
 
-// Time slot structure
-struct TimeSlot {
+// A rule the sketch may hand to the library
+struct ScheduledRule {
   bool enabled;
-  int hour;
-  int minute;
-  String command;
-  bool executedToday;
+  PinRule rule;
 };
 
-// Define 6 time slots
-TimeSlot timeSlots[6] = {
-  // Time Slot 1
-  {
-    true,    // enabled
-    8,       // hour (0-23)
-    0,       // minute (0-59)
-    "switch:2,on",  // command to execute
-    false    // executedToday (internal use, set to false)
-  },
-  // Time Slot 2
-  {
-    true,    // enabled
-    12,      // hour
-    30,      // minute
-    "pwm:4,128",    // command
-    false    // executedToday
-  },
-  // Time Slot 3
-  {
-    false,   // disabled
-    18,      // hour
-    0,       // minute
-    "switch:2,off", // command
-    false    // executedToday
-  },
-  // Time Slot 4
-  {
-    true,    // enabled
-    20,      // hour
-    0,       // minute
-    "fade:12,0,255,10", // command
-    false    // executedToday
-  },
-  // Time Slot 5
-  {
-    false,   // disabled
-    22,      // hour
-    30,      // minute
-    "pwm:13,64",     // command
-    false    // executedToday
-  },
-  // Time Slot 6
-  {
-    true,    // enabled
-    23,      // hour
-    0,       // minute
-    "switch:4,off",  // command
-    false    // executedToday
-  }
+// Define 6 rules
+ScheduledRule schedule[6] = {
+  // Rule 1: pin 2 HIGH at 07:30 on weekdays
+  {true,  {{PIN_CMD_DIGITAL_SET, 2, HIGH, 0, 0}, RULE_WEEKDAYS, RULE_AT_TIME, 7 * 60 + 30}},
+  // Rule 2: pin 4 PWM 128 at 12:30 every day
+  {true,  {{PIN_CMD_PWM_SET, 4, 128, 0, 0}, RULE_EVERY_DAY, RULE_AT_TIME, 12 * 60 + 30}},
+  // Rule 3: pin 2 LOW at 18:00 every day (disabled)
+  {false, {{PIN_CMD_DIGITAL_SET, 2, LOW, 0, 0}, RULE_EVERY_DAY, RULE_AT_TIME, 18 * 60}},
+  // Rule 4: pin 12 PWM 0, hold for 10 seconds, then fade to 255, 15 minutes before sunset
+  {true,  {{PIN_CMD_PWM_FADE_TIME, 12, 0, 255, 10}, RULE_EVERY_DAY, RULE_AT_SUNSET, -15}},
+  // Rule 5: pin 13 PWM 64 at 22:30 on weekends (disabled)
+  {false, {{PIN_CMD_PWM_SET, 13, 64, 0, 0}, RULE_WEEKENDS, RULE_AT_TIME, 22 * 60 + 30}},
+  // Rule 6: pin 4 LOW at 23:00 every day
+  {true,  {{PIN_CMD_DIGITAL_SET, 4, LOW, 0, 0}, RULE_EVERY_DAY, RULE_AT_TIME, 23 * 60}}
 };
 
-// Variables to track the current date
-int currentDay = 0;
-int currentMonth = 0;
-int currentYear = 0;
-
 // Function prototypes
 void setup_wifi();
 void setTimeZone();
 String getCurrentTimeString();
 String getCurrentDateString();
-void getCurrentDate(int &day, int &month, int &year);
-void checkTimeSlots();
-void executeCommand(String command);
-void parseMqttCommand(String cmd);
-void onActionComplete(int pinNum);
+String formatTime(time_t time);
 
 void setup() {
   Serial.begin(115200);
   setup_wifi();
   setTimeZone();
-  
-  // Initialize the date variables
-  getCurrentDate(currentDay, currentMonth, currentYear);
-  
+
+  // Hand the enabled rules to the library; they fire once the clock has been synced
+  myPins.setLocation(latitude, longitude);
+  for (int i = 0; i < 6; i++) {
+    if (schedule[i].enabled && myPins.addRule(schedule[i].rule) < 0) {
+      Serial.println("Error: Rule " + String(i + 1) + " is invalid");
+    }
+  }
+
+  // Run rules and timed operations in their own task, so the delay() in loop() does not hold them up
+  myPins.beginTask();
+
   Serial.println("NTP Time Control Example");
   Serial.println("=========================");
   Serial.print("Current Time: ");
@@ -158,21 +123,21 @@ void setup() {
   Serial.print("Current Date: ");
   Serial.println(getCurrentDateString());
   Serial.println();
-  Serial.println("Time Slots Configuration:");
-  
-  // Print the time slot configuration
+  Serial.println("Rule Configuration:");
+
+  // Print the rule configuration
   for (int i = 0; i < 6; i++) {
-    Serial.print("Slot ");
+    const PinRule& rule = schedule[i].rule;
+    Serial.print("Rule ");
     Serial.print(i + 1);
     Serial.print(": ");
-    Serial.print(timeSlots[i].enabled ? "ENABLED" : "DISABLED");
-    Serial.print(" at ");
-    Serial.print(timeSlots[i].hour);
-    Serial.print(":");
-    if (timeSlots[i].minute < 10) Serial.print("0");
-    Serial.print(timeSlots[i].minute);
-    Serial.print(" - Command: ");
-    Serial.println(timeSlots[i].command);
+    Serial.print(schedule[i].enabled ? "ENABLED" : "DISABLED");
+    if (rule.anchor == RULE_AT_TIME) {
+      Serial.printf(" at %02d:%02d", rule.minutes / 60, rule.minutes % 60);
+    } else {
+      Serial.printf(" %+d min from %s", rule.minutes, rule.anchor == RULE_AT_SUNRISE ? "sunrise" : "sunset");
+    }
+    Serial.printf(" (days 0x%02X) - Pin %d\n", rule.days, rule.command.pinNumber);
   }
   Serial.println();
   Serial.println("System ready. Waiting for scheduled times...");
@@ -185,37 +150,22 @@ void loop() {
     setup_wifi();
     setTimeZone();
   }
-  
-  // Update the pin set for timed operations to work
-  myPins.update();
-  
-  // Check if the date has changed (midnight passed)
-  int day, month, year;
-  getCurrentDate(day, month, year);
-  
-  if (day != currentDay || month != currentMonth || year != currentYear) {
-    // Date has changed, reset all executedToday flags
-    Serial.println("Date changed. Resetting time slot execution flags.");
-    currentDay = day;
-    currentMonth = month;
-    currentYear = year;
-    
-    for (int i = 0; i < 6; i++) {
-      timeSlots[i].executedToday = false;
-    }
-  }
-  
-  // Check time slots
-  checkTimeSlots();
-  
-  // Print current time every minute
+
+  // Print the current time and the next rule every minute
   static unsigned long lastTimePrint = 0;
   if (millis() - lastTimePrint >= 60000) { // Every minute
     Serial.print("Current Time: ");
-    Serial.println(getCurrentTimeString());
+    Serial.print(getCurrentTimeString());
+    Serial.print(" - Next rule: ");
+    Serial.println(formatTime(myPins.nextRuleTime()));
     lastTimePrint = millis();
   }
-  
+
+  // Report pins changed by the rules
+  if (myPins.hasChanges()) {
+    Serial.println("Pins changed: " + myPins.statusDelta());
+  }
+
   // Small delay to prevent busy waiting
   delay(1000);
 }
@@ -242,14 +192,12 @@ void setup_wifi() {
 }
 
 /**
- * @brief Sets up the timezone using NTP.
+ * @brief Sets up the timezone and starts syncing the clock with NTP.
  */
 void setTimeZone() {
-  configTime(0, 0, ntpServer); // Get UTC time from the NTP server (0 offset for UTC)
-  setenv("TZ", timezone, 1); // Set the timezone environment variable
-  tzset(); // Apply the timezone setting
-  
-  Serial.println("Time configured with timezone: " + String(timezone));
+  configTime(timezoneOffset * 3600, useDST ? 3600 : 0, ntpServer);
+
+  Serial.println("Time configured with UTC offset " + String(timezoneOffset) + (useDST ? " (DST)" : ""));
 }
 
 /**
@@ -281,198 +229,17 @@ String getCurrentDateString() {
 }
 
 /**
- * @brief Gets the current date components.
- * @param day Reference to store the day.
- * @param month Reference to store the month.
- * @param year Reference to store the year.
+ * @brief Formats a wall-clock time as local date and time.
+ * @param time The time as returned by time(), or 0.
+ * @return The time in YYYY-MM-DD HH:MM format, or "none" for 0.
  */
-void getCurrentDate(int &day, int &month, int &year) {
-  struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
-    day = 0;
-    month = 0;
-    year = 0;
-    return;
+String formatTime(time_t time) {
+  if (time == 0) {
+    return "none";
   }
-  day = timeinfo.tm_mday;
-  month = timeinfo.tm_mon + 1; // tm_mon is 0-11
-  year = timeinfo.tm_year + 1900; // tm_year is years since 1900
-}
-
-/**
- * @brief Checks if any time slot should be triggered and executes the command if needed.
- */
-void checkTimeSlots() {
   struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
-    return;
-  }
-  
-  int currentHour = timeinfo.tm_hour;
-  int currentMinute = timeinfo.tm_min;
-  
-  for (int i = 0; i < 6; i++) {
-    if (timeSlots[i].enabled && !timeSlots[i].executedToday) {
-      if (currentHour == timeSlots[i].hour && currentMinute == timeSlots[i].minute) {
-        Serial.print("Time Slot ");
-        Serial.print(i + 1);
-        Serial.print(" triggered at ");
-        Serial.print(getCurrentTimeString());
-        Serial.print(". Executing command: ");
-        Serial.println(timeSlots[i].command);
-        
-        // Execute the command
-        executeCommand(timeSlots[i].command);
-        
-        // Mark as executed today
-        timeSlots[i].executedToday = true;
-        
-        Serial.print("Time Slot ");
-        Serial.print(i + 1);
-        Serial.println(" executed successfully.");
-      }
-    }
-  }
-}
-
-/**
- * @brief Executes a command string.
- * @param command The command to execute.
- */
-void executeCommand(String command) {
-  parseMqttCommand(command);
-}
-
-/**
- * @brief A callback function passed to the library to be executed on completion of timed actions.
- * @param pinNum The pin number on which the action completed.
- */
-void onActionComplete(int pinNum) {
-    String message = "Timed action completed on pin " + String(pinNum);
-    Serial.println(message);
+  localtime_r(&time, &timeinfo);
+  char timeStr[17];
+  strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M", &timeinfo);
+  return String(timeStr);
 }
-
-/**
- * @brief Parses the command string and executes the corresponding action.
- * @param cmd The command string (e.g., "switch:2,on" or "pwm:2,88").
- */
-void parseMqttCommand(String cmd) {
-  int colonIndex = cmd.indexOf(':');
-  if (colonIndex == -1) {
-    Serial.println("Error: Invalid command format");
-    return;
-  }
-
-  String cmdType = cmd.substring(0, colonIndex);
-  String argsStr = cmd.substring(colonIndex + 1);
-
-  // Handle digital switch commands
-  if (cmdType == "switch") {
-    int firstComma = argsStr.indexOf(',');
-    if (firstComma == -1) {
-      Serial.println("Error: 'switch' command needs at least 2 arguments");
-      return;
-    }
-
-    int pinNum = argsStr.substring(0, firstComma).toInt();
-    String statePart = argsStr.substring(firstComma + 1);
-    int secondComma = statePart.indexOf(',');
-
-    if (secondComma != -1) {
-      // Timed switch command: e.g., "switch:2,on,30"
-      String state = statePart.substring(0, secondComma);
-      unsigned long duration = statePart.substring(secondComma + 1).toInt();
-      
-      if (state == "on") {
-        myPins.digitalSetTime(pinNum, HIGH, duration, onActionComplete);
-        Serial.println("Pin " + String(pinNum) + " will turn HIGH for " + String(duration) + " seconds");
-      } else if (state == "off") {
-        myPins.digitalSetTime(pinNum, LOW, duration, onActionComplete);
-        Serial.println("Pin " + String(pinNum) + " will turn LOW for " + String(duration) + " seconds");
-      } else {
-        Serial.println("Error: Invalid state for switch command");
-        return;
-      }
-    } else {
-      // Instant switch command: e.g., "switch:2,on"
-      if (statePart == "on") {
-        myPins.digitalSet(pinNum, HIGH);
-        Serial.println("Pin " + String(pinNum) + " turned HIGH");
-      } else if (statePart == "off") {
-        myPins.digitalSet(pinNum, LOW);
-        Serial.println("Pin " + String(pinNum) + " turned LOW");
-      } else {
-        Serial.println("Error: Invalid state for switch command");
-        return;
-      }
-    }
-  } 
-  // Handle PWM commands
-  else if (cmdType == "pwm") {
-    int args[4];
-    int argCount = 0;
-    int lastIndex = -1;
-    
-    while (argCount < 4) {
-      int commaIndex = argsStr.indexOf(',', lastIndex + 1);
-      if (commaIndex == -1) {
-        args[argCount++] = argsStr.substring(lastIndex + 1).toInt();
-        break;
-      }
-      args[argCount++] = argsStr.substring(lastIndex + 1, commaIndex).toInt();
-      lastIndex = commaIndex;
-    }
-
-    if (argCount == 2) { // e.g., pwm:2,88
-      int pin = args[0];
-      int value = args[1];
-      myPins.pwmSet(pin, value);
-      Serial.println("Set pin " + String(pin) + " PWM to " + String(value));
-    } else if (argCount >= 4) { // e.g., pwm:2,128,0,10
-      int pin = args[0];
-      int value = args[1];
-      int time = args[3];
-      myPins.pwmSetTime(pin, value, time, onActionComplete);
-      Serial.println("Set pin " + String(pin) + " PWM to " + String(value) + " for " + String(time) + " seconds");
-    } else {
-      Serial.println("Error: 'pwm' command needs 2 or 4 arguments");
-    }
-  } 
-  // Handle fade commands
-  else if (cmdType == "fade") {
-    int args[4];
-    int argCount = 0;
-    int lastIndex = -1;
-    
-    while (argCount < 4) {
-      int commaIndex = argsStr.indexOf(',', lastIndex + 1);
-      if (commaIndex == -1) {
-        args[argCount++] = argsStr.substring(lastIndex + 1).toInt();
-        break;
-      }
-      args[argCount++] = argsStr.substring(lastIndex + 1, commaIndex).toInt();
-      lastIndex = commaIndex;
-    }
-
-    if (argCount == 3) { // e.g., fade:2,0,128
-      int pin = args[0];
-      int startVal = args[1];
-      int endVal = args[2];
-      myPins.pwmFadeTime(pin, startVal, endVal, 2, onActionComplete); // Using a 2-second default fade
-      Serial.println("Fading pin " + String(pin) + " from " + String(startVal) + " to " + String(endVal));
-    } else if (argCount == 4) { // e.g., fade:2,128,0,10
-      int pin = args[0];
-      int startVal = args[1];
-      int endVal = args[2];
-      int time = args[3];
-      myPins.pwmFadeTime(pin, startVal, endVal, time, onActionComplete);
-      Serial.println("Fading pin " + String(pin) + " from " + String(startVal) + " to " + String(endVal) + " over " + String(time) + " seconds");
-    } else {
-      Serial.println("Error: 'fade' command needs 3 or 4 arguments");
-    }
-  } 
-  // Handle unknown commands
-  else {
-    Serial.println("Error: Unknown command type");
-  }
-}
\ No newline at end of file
@@ -0,0 +1,75 @@
+/*
+ * AvantPinSet RGB Group Fade Example
+ *
+ * Description:
+ * This sketch fades the three channels of an RGB LED together with a pin group.
+ * The channels share one timer and one progress value, so they start, move and
+ * finish in lockstep and the colour blends cleanly from one preset to the next.
+ * A single callback per fade picks the next colour, cycling through a palette.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ * Date: October 14, 2026
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller
+ * - An RGB LED (with suitable resistors, e.g., 220-330 Ohm per channel) on pins 25 (red),
+ *   26 (green) and 27 (blue), common cathode
+ *
+ * Dependencies:
+ * - AvantPinSet Library (AvantPinSet.h, AvantPinSet.cpp)
+ *
+ * Usage Notes:
+ * 1. Upload to your ESP32.
+ * 2. Open the Serial Monitor at 115200 baud.
+ * 3. The LED blends through the palette, two seconds per colour, along the CIE
+ *    brightness curve. Each finished fade is reported on the serial port.
+ *
+ */
+
+#include <AvantPinSet.h>
+
+int myPinList[] = {25, 26, 27};
+const int numPins = 3;
+
+AvantPinSet myPins(myPinList, numPins);
+
+// Colours to cycle through, as {red, green, blue}
+const int palette[][3] = {
+  {255,   0,   0},
+  {255, 160,   0},
+  {  0, 255,  40},
+  {  0,  80, 255},
+  {180,   0, 255}
+};
+const int paletteSize = sizeof(palette) / sizeof(palette[0]);
+
+int rgbGroup = -1;
+int nextColour = 0;
+bool fadeDone = true;
+
+void onFadeComplete(int pinNum) {
+  fadeDone = true;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  // The order of the pins is the order of the values in palette[]
+  rgbGroup = myPins.addGroup("rgb", myPinList, numPins);
+  if (rgbGroup < 0) Serial.println("Error: could not create the group");
+}
+
+void loop() {
+  myPins.update();
+
+  if (fadeDone && rgbGroup >= 0) {
+    fadeDone = false;
+    Serial.printf("Fading to colour %d\n", nextColour);
+
+    // nullptr start values: every fade continues from the colour the LED shows now
+    myPins.groupFade(rgbGroup, nullptr, palette[nextColour], 2000, onFadeComplete, FADE_CIE);
+    nextColour = (nextColour + 1) % paletteSize;
+  }
+}
@@ -0,0 +1,78 @@
+/*
+  Arduino.h - The part of the Arduino core API that AvantPinSet uses, for host builds.
+
+  Pins and the clock are not declared here; the library reaches them through AvantPinSetHal.h,
+  which the host backend (AvantPinSetHost.cpp) implements with a mock clock and a write log.
+  millis() and micros() read the same mock clock, for scenario code that uses them.
+*/
+
+#ifndef AVANT_PIN_SET_HOST_ARDUINO_H
+#define AVANT_PIN_SET_HOST_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+#define IRAM_ATTR
+
+// Like the ESP32 core, min() and max() are the standard templates
+using std::max;
+using std::min;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+
+// Text type of the Arduino core, backed by std::string
+class String {
+public:
+  String() {}
+  String(const char* text) : _text(text ? text : "") {}
+  String(int value) : _text(std::to_string(value)) {}
+  String(unsigned int value) : _text(std::to_string(value)) {}
+  String(long value) : _text(std::to_string(value)) {}
+  String(unsigned long value) : _text(std::to_string(value)) {}
+
+  const char* c_str() const { return _text.c_str(); }
+  unsigned int length() const { return (unsigned int)_text.size(); }
+  bool reserve(unsigned int size) {
+    _text.reserve(size);
+    return true;
+  }
+
+  String& operator+=(const String& other) {
+    _text += other._text;
+    return *this;
+  }
+  String& operator+=(const char* text) {
+    if (text) _text += text;
+    return *this;
+  }
+  String& operator+=(char c) {
+    _text += c;
+    return *this;
+  }
+
+  bool operator==(const String& other) const { return _text == other._text; }
+  bool operator==(const char* text) const { return text && _text == text; }
+  bool operator!=(const String& other) const { return !(*this == other); }
+  bool operator!=(const char* text) const { return !(*this == text); }
+
+  friend String operator+(String left, const String& right) { return left += right; }
+
+private:
+  std::string _text;
+};
+
+#endif // AVANT_PIN_SET_HOST_ARDUINO_H
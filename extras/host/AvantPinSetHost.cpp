@@ -0,0 +1,134 @@
+/*
+  AvantPinSetHost.cpp - Host backend of the AvantPinSet hardware layer.
+*/
+
+#include "AvantPinSetHost.h"
+#include "AvantPinSetHal.h"
+
+namespace {
+
+// Global instances write their pins during static initialization, so the state is set up on
+// first use rather than by constructors that may not have run yet
+uint64_t clockUs = 0;
+bool recording = true;
+size_t totalWrites = 0;
+uint64_t totalSleepUs = 0;
+int pinValues[AVANT_PINSET_HOST_PINS];
+bool pinValuesCleared = false;
+
+std::vector<HostWrite>& writeLog() {
+  static std::vector<HostWrite> log;
+  return log;
+}
+
+int* values() {
+  if (!pinValuesCleared) {
+    for (int& value : pinValues) value = -1;
+    pinValuesCleared = true;
+  }
+  return pinValues;
+}
+
+void record(uint8_t pinNumber, HostWriteKind kind, int value) {
+  totalWrites++;
+  if (recording) writeLog().push_back({clockUs, pinNumber, kind, value});
+}
+
+} // namespace
+
+// --- Hardware layer ---
+namespace AvantPinSetHal {
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  record(pin, HOST_PIN_MODE, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  record(pin, HOST_DIGITAL_WRITE, level);
+  values()[pin] = level;
+}
+
+void analogWrite(uint8_t pin, int value) {
+  record(pin, HOST_ANALOG_WRITE, value);
+  values()[pin] = value;
+}
+
+uint64_t micros64() {
+  return clockUs;
+}
+
+void holdPin(uint8_t pin, bool hold) {
+  (void)pin;
+  (void)hold;
+}
+
+SleepWakeup lightSleep(uint64_t durationUs) {
+  // Always woken by the timer; the mock clock jumps over the sleep
+  clockUs += durationUs;
+  totalSleepUs += durationUs;
+  return SLEEP_WOKE_TIMER;
+}
+
+void delayMicros64(uint64_t durationUs) {
+  clockUs += durationUs;
+}
+
+} // namespace AvantPinSetHal
+
+unsigned long millis() {
+  return (unsigned long)(clockUs / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)clockUs;
+}
+
+// --- Backend control ---
+namespace AvantPinSetHost {
+
+void setMicros(uint64_t timeUs) {
+  clockUs = timeUs;
+}
+
+void advanceMicros(uint64_t deltaUs) {
+  clockUs += deltaUs;
+}
+
+uint64_t nowMicros() {
+  return clockUs;
+}
+
+void setRecording(bool enabled) {
+  recording = enabled;
+}
+
+const std::vector<HostWrite>& writes() {
+  return writeLog();
+}
+
+size_t writeCount() {
+  return totalWrites;
+}
+
+void clearWrites() {
+  writeLog().clear();
+  totalWrites = 0;
+}
+
+uint64_t sleptMicros() {
+  return totalSleepUs;
+}
+
+int pinValue(uint8_t pinNumber) {
+  return values()[pinNumber];
+}
+
+void reset() {
+  clockUs = 0;
+  totalSleepUs = 0;
+  recording = true;
+  clearWrites();
+  pinValuesCleared = false;
+}
+
+} // namespace AvantPinSetHost
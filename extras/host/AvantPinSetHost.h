@@ -0,0 +1,96 @@
+/*
+  AvantPinSetHost.h - Host backend of the AvantPinSet hardware layer.
+
+  Implements AvantPinSetHal.h on a PC: the scheduler clock is a mock that only moves when the
+  caller advances it, and every pinMode(), digitalWrite() and analogWrite() of the library is
+  recorded, so scenarios run deterministically and their output can be checked or profiled.
+  Light sleep and delays move the mock clock forward by the requested time.
+*/
+
+#ifndef AVANT_PIN_SET_HOST_H
+#define AVANT_PIN_SET_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Highest pin number the backend keeps an output value for, plus one
+#define AVANT_PINSET_HOST_PINS 256
+
+enum HostWriteKind : uint8_t {
+  HOST_PIN_MODE,
+  HOST_DIGITAL_WRITE,
+  HOST_ANALOG_WRITE
+};
+
+// One recorded hardware access
+struct HostWrite {
+  uint64_t timeUs; // Mock clock at the time of the write
+  uint8_t pinNumber;
+  HostWriteKind kind;
+  int value;       // Mode, digital level or PWM value
+};
+
+namespace AvantPinSetHost {
+
+/**
+ * @brief Set the mock clock read by the library's scheduler and by millis()/micros().
+ * @param timeUs The new time in microseconds. The clock starts at 0.
+ */
+void setMicros(uint64_t timeUs);
+
+/**
+ * @brief Move the mock clock forward.
+ * @param deltaUs The time to add in microseconds.
+ */
+void advanceMicros(uint64_t deltaUs);
+
+/**
+ * @brief Get the mock clock.
+ * @return The current time in microseconds.
+ */
+uint64_t nowMicros();
+
+/**
+ * @brief Turn the write log on or off. Pin values and the write count are kept either way, so
+ *        long benchmark runs can turn the log off to keep their memory use flat.
+ * @param enabled True to append every write to writes() (the default).
+ */
+void setRecording(bool enabled);
+
+/**
+ * @brief Get the recorded writes, oldest first.
+ * @return The writes since the last clearWrites() while recording was on.
+ */
+const std::vector<HostWrite>& writes();
+
+/**
+ * @brief Get the number of writes since the last clearWrites(), recorded or not.
+ */
+size_t writeCount();
+
+/**
+ * @brief Clear the write log and the write count. Pin values are kept.
+ */
+void clearWrites();
+
+/**
+ * @brief Get the total time the library has spent in light sleep since the last reset().
+ */
+uint64_t sleptMicros();
+
+/**
+ * @brief Get the last value written to a pin.
+ * @param pinNumber The pin number.
+ * @return The last digital level or PWM value, or -1 if the pin was never written.
+ */
+int pinValue(uint8_t pinNumber);
+
+/**
+ * @brief Reset the backend: clock to 0, write log, write count, sleep time and pin values cleared, recording on.
+ */
+void reset();
+
+} // namespace AvantPinSetHost
+
+#endif // AVANT_PIN_SET_HOST_H
@@ -0,0 +1,288 @@
+/*
+  AvantPinSetBenchmark.cpp - Google Benchmark scenarios for the AvantPinSet scheduler and status serializers.
+
+  Runs on the host backend, so the clock only moves when a scenario advances it and the results
+  do not depend on WiFi, interrupts or flash caches. One instance manages at most
+  AVANT_PINSET_MAX_PINS pins, so the scheduler scenarios reach thousands of pins by running many
+  instances side by side, the way a large installation would split its pins.
+
+  Compare two builds with the compare.py script that ships with Google Benchmark:
+    AvantPinSetBenchmark --benchmark_out=before.json
+    AvantPinSetBenchmark --benchmark_out=after.json
+    compare.py benchmarks before.json after.json
+*/
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+#include "AvantPinSet.h"
+#include "AvantPinSetHost.h"
+
+namespace {
+
+// A number of pins spread over as many instances as they need
+class PinSets {
+public:
+  explicit PinSets(int totalPins) : _totalPins(totalPins) {
+    AvantPinSetHost::reset();
+    AvantPinSetHost::setRecording(false); // Keep memory flat over millions of writes
+
+    int pinList[AVANT_PINSET_MAX_PINS];
+    for (int i = 0; i < AVANT_PINSET_MAX_PINS; i++) pinList[i] = i;
+    for (int remaining = totalPins; remaining > 0; remaining -= AVANT_PINSET_MAX_PINS) {
+      int count = remaining < AVANT_PINSET_MAX_PINS ? remaining : AVANT_PINSET_MAX_PINS;
+      _sets.emplace_back(new AvantPinSet(pinList, count));
+    }
+    AvantPinSetHost::clearWrites(); // Count only the writes of the scenario
+  }
+
+  // Calls action(set, pinNumber, n) for every pin, n counting all pins from 0
+  template <typename Action>
+  void forEachPin(Action action) {
+    int n = 0;
+    for (auto& set : _sets) {
+      int count = _totalPins - n < AVANT_PINSET_MAX_PINS ? _totalPins - n : AVANT_PINSET_MAX_PINS;
+      for (int pin = 0; pin < count; pin++, n++) action(*set, pin, n);
+    }
+  }
+
+  void updateAll() {
+    for (auto& set : _sets) set->update();
+  }
+
+private:
+  int _totalPins;
+  std::vector<std::unique_ptr<AvantPinSet>> _sets;
+};
+
+void setPinCounters(benchmark::State& state) {
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["pins"] = (double)state.range(0);
+  state.counters["writes"] = benchmark::Counter((double)AvantPinSetHost::writeCount(), benchmark::Counter::kAvgIterations);
+}
+
+// --- Scheduler ---
+
+// Nothing scheduled: the cost of polling update() from loop()
+void BM_UpdateIdle(benchmark::State& state) {
+  PinSets sets((int)state.range(0));
+  for (auto _ : state) {
+    AvantPinSetHost::advanceMicros(100);
+    sets.updateAll();
+  }
+  setPinCounters(state);
+}
+
+// Every pin waits on a timer that does not come due: update() only checks the earliest deadline
+void BM_UpdatePendingTimers(benchmark::State& state) {
+  PinSets sets((int)state.range(0));
+  sets.forEachPin([](AvantPinSet& set, int pin, int) { set.digitalSetTimeUs(pin, HIGH, 3600000000ULL); });
+  for (auto _ : state) {
+    AvantPinSetHost::advanceMicros(100);
+    sets.updateAll();
+  }
+  setPinCounters(state);
+}
+
+// Every pin's timer comes due in the same update(), with deadlines spread over 1 ms so the
+// heap really has to order them
+void BM_UpdateDueTimers(benchmark::State& state) {
+  PinSets sets((int)state.range(0));
+  int level = HIGH;
+  for (auto _ : state) {
+    state.PauseTiming();
+    sets.forEachPin([level](AvantPinSet& set, int pin, int n) {
+      set.digitalSetTimeUs(pin, level, 1000 + (uint64_t)((n * 7919) % 1000));
+    });
+    AvantPinSetHost::advanceMicros(2000);
+    level = level == HIGH ? LOW : HIGH;
+    state.ResumeTiming();
+
+    sets.updateAll();
+  }
+  setPinCounters(state);
+}
+
+// Fades all pins selected by the filter between 0 and 255 in FADE_TICKS steps of FADE_TICK_US,
+// so each pin takes one step in every update() of the scenario
+const int FADE_TICKS = 255;
+const uint64_t FADE_TICK_US = 4000;
+
+template <typename Filter>
+void startFades(PinSets& sets, bool rising, Filter filter) {
+  sets.forEachPin([rising, &filter](AvantPinSet& set, int pin, int n) {
+    if (filter(n)) set.pwmFade(pin, rising ? 0 : 255, rising ? 255 : 0, FADE_TICKS * FADE_TICK_US / 1000, n % 4 ? FADE_LINEAR : FADE_GAMMA);
+  });
+}
+
+// Every pin runs a software fade that takes a step in every update()
+void BM_UpdateFading(benchmark::State& state) {
+  PinSets sets((int)state.range(0));
+  auto allPins = [](int) { return true; };
+  bool rising = true;
+  int tick = 0;
+  startFades(sets, rising, allPins);
+  for (auto _ : state) {
+    AvantPinSetHost::advanceMicros(FADE_TICK_US);
+    sets.updateAll();
+
+    // Turn the fades around before they finish
+    if (++tick == FADE_TICKS - 1) {
+      state.PauseTiming();
+      rising = !rising;
+      tick = 0;
+      startFades(sets, rising, allPins);
+      state.ResumeTiming();
+    }
+  }
+  setPinCounters(state);
+}
+
+// A pin that blinks forever: each timer's callback arms the next one
+struct Blinker {
+  AvantPinSet* set;
+  int pin;
+  int level;
+  uint64_t periodUs;
+
+  void arm() {
+    level = level == HIGH ? LOW : HIGH;
+    set->digitalSetTimeUs(pin, level, periodUs, [this](int) { arm(); });
+  }
+};
+
+// Half the pins blink with periods between 0.5 and 5.5 ms, the other half fade
+void BM_UpdateMixed(benchmark::State& state) {
+  PinSets sets((int)state.range(0));
+  std::vector<Blinker> blinkers;
+  blinkers.reserve(state.range(0)); // The callbacks point into the vector
+  sets.forEachPin([&blinkers](AvantPinSet& set, int pin, int n) {
+    if (n % 2) return;
+    blinkers.push_back({&set, pin, LOW, 500 + (uint64_t)(n % 500) * 10});
+    blinkers.back().arm();
+  });
+
+  auto oddPins = [](int n) { return n % 2 != 0; };
+  bool rising = true;
+  int tick = 0;
+  startFades(sets, rising, oddPins);
+  for (auto _ : state) {
+    AvantPinSetHost::advanceMicros(FADE_TICK_US);
+    sets.updateAll();
+
+    if (++tick == FADE_TICKS - 1) {
+      state.PauseTiming();
+      rising = !rising;
+      tick = 0;
+      startFades(sets, rising, oddPins);
+      state.ResumeTiming();
+    }
+  }
+  setPinCounters(state);
+}
+
+BENCHMARK(BM_UpdateIdle)->Arg(64)->Arg(512)->Arg(4096);
+BENCHMARK(BM_UpdatePendingTimers)->Arg(64)->Arg(512)->Arg(4096);
+BENCHMARK(BM_UpdateDueTimers)->Arg(64)->Arg(512)->Arg(4096);
+BENCHMARK(BM_UpdateFading)->Arg(64)->Arg(512)->Arg(4096);
+BENCHMARK(BM_UpdateMixed)->Arg(64)->Arg(512)->Arg(4096);
+
+// --- Status serializers ---
+
+// One full instance with a mix of digital and PWM pins
+class StatusFixture {
+public:
+  explicit StatusFixture(int pins) : _sets(pins), _pins(pins) {
+    _sets.forEachPin([this](AvantPinSet& set, int pin, int n) {
+      _set = &set;
+      if (n % 2) {
+        set.pwmSet(pin, (n * 37) % 256);
+      } else {
+        set.digitalSet(pin, n % 4 ? HIGH : LOW);
+      }
+    });
+  }
+
+  AvantPinSet& set() { return *_set; }
+  int pins() const { return _pins; }
+
+private:
+  PinSets _sets;
+  int _pins;
+  AvantPinSet* _set = nullptr;
+};
+
+void BM_SystemStatusString(benchmark::State& state) {
+  StatusFixture fixture((int)state.range(0));
+  for (auto _ : state) {
+    String status = fixture.set().systemStatus();
+    benchmark::DoNotOptimize(status);
+  }
+  setPinCounters(state);
+}
+
+void BM_SystemStatusBuffer(benchmark::State& state) {
+  StatusFixture fixture((int)state.range(0));
+  char buffer[1024];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fixture.set().systemStatus(buffer, sizeof(buffer)));
+    benchmark::ClobberMemory();
+  }
+  setPinCounters(state);
+}
+
+// A quarter of the pins change between two deltas
+void BM_StatusDeltaBuffer(benchmark::State& state) {
+  StatusFixture fixture((int)state.range(0));
+  char buffer[1024];
+  int value = 0;
+  for (auto _ : state) {
+    value = (value + 1) % 256;
+    for (int pin = 1; pin < fixture.pins(); pin += 4) fixture.set().pwmSet(pin, value);
+    benchmark::DoNotOptimize(fixture.set().statusDelta(buffer, sizeof(buffer)));
+    benchmark::ClobberMemory();
+  }
+  setPinCounters(state);
+}
+
+void BM_PackedStatus(benchmark::State& state) {
+  StatusFixture fixture((int)state.range(0));
+  uint8_t buffer[1 + AVANT_PINSET_MAX_PINS * PIN_PACKED_STATUS_SIZE];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fixture.set().packedStatus(buffer, sizeof(buffer)));
+    benchmark::ClobberMemory();
+  }
+  setPinCounters(state);
+}
+
+void BM_PinStatusString(benchmark::State& state) {
+  StatusFixture fixture((int)state.range(0));
+  PinHandle handle = fixture.set().getHandle(fixture.pins() - 1);
+  for (auto _ : state) {
+    String status = fixture.set().pinStatus(handle);
+    benchmark::DoNotOptimize(status);
+  }
+  setPinCounters(state);
+}
+
+void BM_PinStatusBuffer(benchmark::State& state) {
+  StatusFixture fixture((int)state.range(0));
+  PinHandle handle = fixture.set().getHandle(fixture.pins() - 1);
+  char buffer[64];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fixture.set().pinStatus(handle, buffer, sizeof(buffer)));
+    benchmark::ClobberMemory();
+  }
+  setPinCounters(state);
+}
+
+BENCHMARK(BM_SystemStatusString)->Arg(8)->Arg(64);
+BENCHMARK(BM_SystemStatusBuffer)->Arg(8)->Arg(64);
+BENCHMARK(BM_StatusDeltaBuffer)->Arg(8)->Arg(64);
+BENCHMARK(BM_PackedStatus)->Arg(8)->Arg(64);
+BENCHMARK(BM_PinStatusString)->Arg(8)->Arg(64);
+BENCHMARK(BM_PinStatusBuffer)->Arg(8)->Arg(64);
+
+} // namespace
+
+BENCHMARK_MAIN();
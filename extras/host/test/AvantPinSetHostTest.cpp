@@ -0,0 +1,210 @@
+/*
+  AvantPinSetHostTest.cpp - Behaviour tests of AvantPinSet on the host backend.
+
+  Each test drives one instance through the mock clock and checks the pin writes the library
+  recorded, with their timestamps. Run without arguments for all tests, or with a test name
+  for one (ctest registers each test on its own).
+*/
+
+#include <AvantPinSet.h>
+#include <AvantPinSetHost.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                        \
+  do {                                                                          \
+    if (!(condition)) {                                                         \
+      printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);   \
+      failures++;                                                               \
+    }                                                                           \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                                \
+  do {                                                                                            \
+    long long actualValue = (long long)(actual);                                                  \
+    long long expectedValue = (long long)(expected);                                              \
+    if (actualValue != expectedValue) {                                                           \
+      printf("  %s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, actualValue,    \
+             expectedValue);                                                                      \
+      failures++;                                                                                 \
+    }                                                                                             \
+  } while (0)
+
+// The recorded writes of one kind to one pin, oldest first
+std::vector<HostWrite> writesTo(uint8_t pinNumber, HostWriteKind kind) {
+  std::vector<HostWrite> result;
+  for (const HostWrite& write : AvantPinSetHost::writes()) {
+    if (write.pinNumber == pinNumber && write.kind == kind) result.push_back(write);
+  }
+  return result;
+}
+
+// Calls update() every stepUs until the mock clock reaches endUs
+void runUntil(AvantPinSet& pins, uint64_t endUs, uint64_t stepUs) {
+  while (AvantPinSetHost::nowMicros() < endUs) {
+    AvantPinSetHost::advanceMicros(stepUs);
+    pins.update();
+  }
+}
+
+int callbackCount = 0;
+uint64_t callbackTimeUs = 0;
+
+void countCallback(int pinNum) {
+  (void)pinNum;
+  callbackCount++;
+  callbackTimeUs = AvantPinSetHost::nowMicros();
+}
+
+// Every test starts from a fresh backend: clock at 0, empty write log, no callbacks seen
+void resetBackend() {
+  AvantPinSetHost::reset();
+  callbackCount = 0;
+  callbackTimeUs = 0;
+}
+
+// --- Tests ---
+
+// A timed digital set drives the pin at once and reverts it exactly when the delay is over
+void testTimedRevert() {
+  resetBackend();
+  const int pinList[] = {2};
+  AvantPinSet pins(pinList, 1);
+  AvantPinSetHost::clearWrites();
+
+  pins.digitalSetTimeMs(2, HIGH, 50, countCallback);
+  runUntil(pins, 49000, 1000);
+  std::vector<HostWrite> writes = writesTo(2, HOST_DIGITAL_WRITE);
+  CHECK_EQ(writes.size(), 1);
+  CHECK_EQ(writes[0].value, HIGH);
+  CHECK_EQ(writes[0].timeUs, 0);
+  CHECK_EQ(callbackCount, 0);
+
+  runUntil(pins, 60000, 1000);
+  writes = writesTo(2, HOST_DIGITAL_WRITE);
+  CHECK_EQ(writes.size(), 2);
+  CHECK_EQ(writes.back().value, LOW);
+  CHECK_EQ(writes.back().timeUs, 50000);
+  CHECK_EQ(callbackCount, 1);
+  CHECK_EQ(callbackTimeUs, 50000);
+  CHECK_EQ(AvantPinSetHost::pinValue(2), LOW);
+  CHECK(pins.nextDeadlineUs() == AvantPinSet::NO_DEADLINE_US);
+}
+
+// A fade starts at its start value, ends exactly on its finish value at the planned time,
+// never moves backwards and never writes the same duty twice in a row
+void testFadeEndpoints() {
+  resetBackend();
+  const int pinList[] = {4};
+  AvantPinSet pins(pinList, 1);
+  AvantPinSetHost::clearWrites();
+
+  pins.pwmFade(4, 10, 200, 1000);
+  runUntil(pins, 1200000, 500);
+
+  std::vector<HostWrite> writes = writesTo(4, HOST_ANALOG_WRITE);
+  CHECK(writes.size() > 2);
+  CHECK_EQ(writes.front().value, 10);
+  CHECK_EQ(writes.front().timeUs, 0);
+  CHECK_EQ(writes.back().value, 200);
+  CHECK_EQ(writes.back().timeUs, 1000000);
+  for (size_t i = 1; i < writes.size(); i++) {
+    CHECK(writes[i].value > writes[i - 1].value);
+  }
+  CHECK(pins.nextDeadlineUs() == AvantPinSet::NO_DEADLINE_US);
+}
+
+// Queued actions start one after the other as the previous one completes
+void testActionQueue() {
+  resetBackend();
+  const int pinList[] = {5};
+  AvantPinSet pins(pinList, 1);
+  AvantPinSetHost::clearWrites();
+
+  CHECK(pins.queueAction({PIN_CMD_DIGITAL_SET_TIME, 5, HIGH, 0, 1}));
+  CHECK(pins.queueAction({PIN_CMD_PWM_SET_TIME, 5, 40, 0, 2}));
+  CHECK(pins.queueAction({PIN_CMD_PWM_SET, 5, 90, 0, 0}, countCallback));
+
+  // HIGH now and LOW after 1 s; then 40 for 2 s, reverting to 0; then 90. The revert and the
+  // last command run in the same update(), so the pin only gets the final duty
+  runUntil(pins, 4000000, 10000);
+  std::vector<HostWrite> digital = writesTo(5, HOST_DIGITAL_WRITE);
+  CHECK_EQ(digital.size(), 2);
+  CHECK_EQ(digital[0].value, HIGH);
+  CHECK_EQ(digital[0].timeUs, 0);
+  CHECK_EQ(digital[1].value, LOW);
+  CHECK_EQ(digital[1].timeUs, 1000000);
+
+  std::vector<HostWrite> pwm = writesTo(5, HOST_ANALOG_WRITE);
+  CHECK_EQ(pwm.size(), 2);
+  CHECK_EQ(pwm[0].value, 40);
+  CHECK_EQ(pwm[0].timeUs, 1000000);
+  CHECK_EQ(pwm[1].value, 90);
+  CHECK_EQ(pwm[1].timeUs, 3000000);
+
+  CHECK_EQ(callbackCount, 1);
+  CHECK_EQ(callbackTimeUs, 3000000);
+  CHECK_EQ(pins.queuedActions(5), 0);
+}
+
+// A pulse train writes every edge on time, completes once and leaves the pin idle
+void testPulseCompletion() {
+  resetBackend();
+  const int pinList[] = {12};
+  AvantPinSet pins(pinList, 1);
+  AvantPinSetHost::clearWrites();
+
+  CHECK(pins.pulseTrain(12, 100, 200, 3, countCallback));
+  runUntil(pins, 2000, 50);
+
+  std::vector<HostWrite> edges = writesTo(12, HOST_DIGITAL_WRITE);
+  const uint64_t edgeTimes[] = {0, 100, 300, 400, 600, 700};
+  CHECK_EQ(edges.size(), 6);
+  for (size_t i = 0; i < edges.size() && i < 6; i++) {
+    CHECK_EQ(edges[i].value, (i % 2 == 0) ? HIGH : LOW);
+    CHECK_EQ(edges[i].timeUs, edgeTimes[i]);
+  }
+  CHECK_EQ(callbackCount, 1);
+  CHECK_EQ(callbackTimeUs, 700);
+  CHECK_EQ(AvantPinSetHost::pinValue(12), LOW);
+  CHECK(pins.nextDeadlineUs() == AvantPinSet::NO_DEADLINE_US);
+}
+
+struct TestCase {
+  const char* name;
+  void (*run)();
+};
+
+const TestCase tests[] = {
+  {"TimedRevert", testTimedRevert},
+  {"FadeEndpoints", testFadeEndpoints},
+  {"ActionQueue", testActionQueue},
+  {"PulseCompletion", testPulseCompletion},
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const char* only = (argc > 1) ? argv[1] : nullptr;
+  int run = 0;
+
+  for (const TestCase& test : tests) {
+    if (only && strcmp(only, test.name) != 0) continue;
+    int failuresBefore = failures;
+    test.run();
+    printf("%s %s\n", failures == failuresBefore ? "PASS" : "FAIL", test.name);
+    run++;
+  }
+
+  if (run == 0) {
+    printf("No test named %s\n", only);
+    return 1;
+  }
+  return failures == 0 ? 0 : 1;
+}
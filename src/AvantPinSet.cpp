@@ -3,256 +3,2736 @@
 */
 
 #include "AvantPinSet.h"
-#include <ArduinoJson.h>
+#include "AvantPinSetCurves.h"
+#include "AvantPinSetHal.h"
+#include <math.h>
+#include <sys/time.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#endif
+
+#if AVANT_PINSET_HAS_LEDC_FADE || AVANT_PINSET_HAS_LEDC_CHANNEL
+#include "driver/ledc.h"
+#include "esp32-hal-periman.h"
+#endif
+
+const unsigned long AvantPinSet::NO_DEADLINE;
+const uint64_t AvantPinSet::NO_DEADLINE_US;
+
+namespace {
+
+// Pins in a pulse report HIGH/LOW like digital pins
+inline bool isDigitalMode(PinModeState mode) {
+  return mode == PIN_MODE_DIGITAL || mode == PIN_MODE_PULSE;
+}
+
+#if AVANT_PINSET_HAS_ESP_TIMER
+// Serializes the pulse edges written from the esp_timer task with starting and stopping pulses
+portMUX_TYPE pulseLock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+// Appends text to a caller-supplied buffer without allocating. Like snprintf(), it keeps
+// counting once the buffer is full, so the caller learns the length it would have needed.
+class StatusWriter {
+public:
+  StatusWriter(char* buffer, size_t size) : _buffer(buffer), _size(size), _length(0) {}
+
+  void append(const char* text) {
+    while (*text) {
+      if (_length + 1 < _size) _buffer[_length] = *text;
+      _length++;
+      text++;
+    }
+  }
+
+  void appendInt(int value) {
+    char digits[12];
+    snprintf(digits, sizeof(digits), "%d", value);
+    append(digits);
+  }
+
+  void appendUnsigned(uint32_t value) {
+    char digits[12];
+    snprintf(digits, sizeof(digits), "%lu", (unsigned long)value);
+    append(digits);
+  }
+
+  // Appends the value reported for a pin: HIGH/LOW in digital mode, the PWM value otherwise
+  void appendPinValue(const PinData& pin) {
+    append("\"");
+    if (isDigitalMode(pin.currentMode)) {
+      append(pin.currentValue == HIGH ? "HIGH" : "LOW");
+    } else {
+      appendInt(pin.currentValue);
+    }
+    append("\"");
+  }
+
+  // Terminates the buffer and returns the full length of the output, excluding the terminator
+  size_t finish() {
+    if (_size > 0) _buffer[(_length < _size) ? _length : _size - 1] = '\0';
+    return _length;
+  }
+
+private:
+  char* _buffer;
+  size_t _size;
+  size_t _length;
+};
+
+// Builds a String with one of the allocation-free writers. Small outputs are written on the
+// stack; larger ones are sized by the first pass, so the text is only allocated once more.
+template <typename Writer>
+String writerString(Writer write) {
+  char stackBuffer[256];
+  size_t length = write(stackBuffer, sizeof(stackBuffer));
+  if (length < sizeof(stackBuffer)) return String(stackBuffer);
+
+  char* heapBuffer = (char*)malloc(length + 1);
+  if (!heapBuffer) return String();
+  write(heapBuffer, length + 1);
+  String output(heapBuffer);
+  free(heapBuffer);
+  return output;
+}
+
+size_t writeStats(const PinSetStats& stats, char* buffer, size_t bufferSize) {
+  StatusWriter out(buffer, bufferSize);
+  out.append("{\"updateCalls\":");
+  out.appendUnsigned(stats.updateCalls);
+  out.append(",\"actionsFired\":");
+  out.appendUnsigned(stats.actionsFired);
+  out.append(",\"callbacksRun\":");
+  out.appendUnsigned(stats.callbacksRun);
+  out.append(",\"maxLatenessMicros\":");
+  out.appendUnsigned(stats.maxLatenessMicros);
+  out.append(",\"maxUpdateMicros\":");
+  out.appendUnsigned(stats.maxUpdateMicros);
+  out.append(",\"eventsDropped\":");
+  out.appendUnsigned(stats.eventsDropped);
+  out.append("}");
+  return out.finish();
+}
+
+// Little-endian field access for the binary protocol, independent of alignment and byte order
+inline uint16_t readLe16(const uint8_t* data) {
+  return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+inline uint32_t readLe32(const uint8_t* data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+inline void writeLe16(uint8_t* data, uint16_t value) {
+  data[0] = (uint8_t)value;
+  data[1] = (uint8_t)(value >> 8);
+}
+
+inline void writeLe32(uint8_t* data, uint32_t value) {
+  writeLe16(data, (uint16_t)value);
+  writeLe16(data + 2, (uint16_t)(value >> 16));
+}
+
+// Scheduler time base in microseconds, see AvantPinSetHal.h
+inline uint64_t clockMicros() {
+  return AvantPinSetHal::micros64();
+}
+
+// Binary snapshot layout: a header followed by one entry per pin, in the device's byte order
+struct SnapshotHeader {
+  uint32_t magic;       // SNAPSHOT_MAGIC
+  uint32_t pinListHash; // Pin list of the instance that wrote the snapshot
+  uint32_t checksum;    // FNV-1a of the entries
+  uint8_t version;      // SNAPSHOT_VERSION
+  uint8_t count;        // Number of entries
+  uint16_t reserved;
+};
+
+struct SnapshotEntry {
+  uint32_t remainingMs;  // Time left on the pending timer, hold or fade, 0 if none
+  uint32_t fadeMs;       // Fade duration following a hold
+  uint32_t pwmFrequency;
+  uint16_t value;        // Current digital level or PWM value
+  uint16_t startValue;   // Fade start value of a hold
+  uint16_t finishValue;  // Fade finish value
+  uint8_t pinNumber;
+  uint8_t mode;          // PIN_MODE_DIGITAL, PIN_MODE_PWM, PIN_MODE_HOLD or PIN_MODE_FADING
+  uint8_t curve;
+  uint8_t pwmResolution;
+  uint16_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 16 && sizeof(SnapshotEntry) == 24, "Snapshot layout must not depend on padding");
+
+const uint32_t SNAPSHOT_MAGIC = 0x31535041UL; // "APS1"
+const uint8_t SNAPSHOT_VERSION = 1;
+
+inline uint32_t fnv1a(const uint8_t* data, size_t length, uint32_t hash = 2166136261UL) {
+  while (length--) hash = (hash ^ *data++) * 16777619UL;
+  return hash;
+}
+
+// Checks a snapshot's header and checksum; returns the number of entries, or -1 if it is not valid
+int snapshotEntries(const uint8_t* data, size_t length) {
+  SnapshotHeader header;
+  if (!data || length < sizeof(header)) return -1;
+  memcpy(&header, data, sizeof(header));
+
+  size_t entriesLength = (size_t)header.count * sizeof(SnapshotEntry);
+  if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION || length < sizeof(header) + entriesLength) return -1;
+  if (fnv1a(data + sizeof(header), entriesLength) != header.checksum) return -1;
+  return header.count;
+}
+
+inline SnapshotHeader snapshotHeader(const uint8_t* data) {
+  SnapshotHeader header;
+  memcpy(&header, data, sizeof(header));
+  return header;
+}
+
+// Snapshot store of SNAPSHOT_RTC and SNAPSHOT_NVS. On the ESP32 it sits in RTC memory that is
+// not cleared at reset, so it is still there after a restart; elsewhere it only lasts until reset.
+#if defined(ARDUINO_ARCH_ESP32)
+RTC_NOINIT_ATTR uint32_t rtcSnapshot[AVANT_PINSET_SNAPSHOT_SIZE / 4];
+#else
+uint32_t rtcSnapshot[AVANT_PINSET_SNAPSHOT_SIZE / 4];
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+const char* const SNAPSHOT_NVS_NAMESPACE = "AvantPinSet";
+
+// One NVS key per pin list, so a changed pin list never restores somebody else's snapshot
+struct SnapshotNvs {
+  explicit SnapshotNvs(uint32_t pinListHash, nvs_open_mode_t mode) : _open(false) {
+    snprintf(key, sizeof(key), "snap%08lx", (unsigned long)pinListHash);
+    // Global instances are constructed before the Arduino core initializes NVS
+    nvs_flash_init();
+    _open = nvs_open(SNAPSHOT_NVS_NAMESPACE, mode, &_handle) == ESP_OK;
+  }
+  ~SnapshotNvs() {
+    if (_open) nvs_close(_handle);
+  }
+
+  size_t read(uint8_t* buffer, size_t size) {
+    size_t length = size;
+    return (_open && nvs_get_blob(_handle, key, buffer, &length) == ESP_OK) ? length : 0;
+  }
+
+  bool write(const uint8_t* data, size_t length) {
+    return _open && nvs_set_blob(_handle, key, data, length) == ESP_OK && nvs_commit(_handle) == ESP_OK;
+  }
+
+  void erase() {
+    if (_open && nvs_erase_key(_handle, key) == ESP_OK) nvs_commit(_handle);
+  }
+
+  char key[16];
+
+private:
+  nvs_handle_t _handle;
+  bool _open;
+};
+#endif
+
+#ifdef AVANT_PINSET_PROFILING
+PinSetProfile profiles[PROFILE_PATH_COUNT];
+
+inline uint32_t profileClock() {
+#if defined(ARDUINO_ARCH_ESP32)
+  return ESP.getCycleCount();
+#else
+  return (uint32_t)AvantPinSetHal::micros64();
+#endif
+}
+
+// Adds the time between construction and destruction to a profiled path
+class ProfileScope {
+public:
+  explicit ProfileScope(PinSetProfilePath path) : _path(path), _start(profileClock()) {}
+
+  ~ProfileScope() {
+    uint32_t cycles = profileClock() - _start;
+    PinSetProfile& profile = profiles[_path];
+    if (profile.calls == 0 || cycles < profile.minCycles) profile.minCycles = cycles;
+    if (cycles > profile.maxCycles) profile.maxCycles = cycles;
+    profile.totalCycles += cycles;
+    profile.calls++;
+  }
+
+private:
+  PinSetProfilePath _path;
+  uint32_t _start;
+};
+
+#define AVANT_PINSET_PROFILE(path) ProfileScope profileScope(path)
+#else
+#define AVANT_PINSET_PROFILE(path) ((void)0)
+#endif
+
+// Next fire time of a rule that cannot be scheduled (sun rule without a location, or polar day)
+const int64_t RULE_NEVER = INT64_MAX;
+
+// Days since 1970-01-01 of a civil date (proleptic Gregorian calendar)
+int64_t daysFromCivil(int year, int month, int day) {
+  year -= month <= 2;
+  int era = (year >= 0 ? year : year - 399) / 400;
+  int yearOfEra = year - era * 400;
+  int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return (int64_t)era * 146097 + dayOfEra - 719468;
+}
+
+// Minutes after UTC midnight of sunrise or sunset on a day of the year, using the NOAA
+// approximation (about a minute of error). False if the sun does not rise or set that day.
+bool sunEventMinutes(int dayOfYear, float latitude, float longitude, bool sunrise, float& minutes) {
+  const float degToRad = 0.01745329f;
+  float gamma = 2.0f * (float)M_PI / 365.0f * (dayOfYear - 1);
+  float eqTime = 229.18f * (0.000075f + 0.001868f * cosf(gamma) - 0.032077f * sinf(gamma) -
+                            0.014615f * cosf(2 * gamma) - 0.040849f * sinf(2 * gamma));
+  float decl = 0.006918f - 0.399912f * cosf(gamma) + 0.070257f * sinf(gamma) - 0.006758f * cosf(2 * gamma) +
+               0.000907f * sinf(2 * gamma) - 0.002697f * cosf(3 * gamma) + 0.00148f * sinf(3 * gamma);
+
+  // Hour angle of the sun's upper edge at the horizon, with refraction
+  float lat = latitude * degToRad;
+  float cosHourAngle = cosf(90.833f * degToRad) / (cosf(lat) * cosf(decl)) - tanf(lat) * tanf(decl);
+  if (cosHourAngle < -1.0f || cosHourAngle > 1.0f) return false; // Polar day or night
+
+  float hourAngle = acosf(cosHourAngle) / degToRad;
+  minutes = 720.0f - 4.0f * (longitude + (sunrise ? hourAngle : -hourAngle)) - eqTime;
+  return true;
+}
+
+} // namespace
 
 // Constructor
-AvantPinSet::AvantPinSet(const int pinList[], int numPins) {
+AvantPinSet::AvantPinSet(const int pinList[], int numPins, uint32_t pwmFrequency, uint8_t pwmResolution,
+                         PinSnapshotMode snapshotMode)
+    : AvantPinSet(pinList, numPins, pwmFrequency, pwmResolution, snapshotMode,
+                  new PinData[storageSize(numPins)], new PinTimer[storageSize(numPins)],
+                  new int8_t[storageSize(numPins)]) {
+  // Sized once up front, so the pin table is never reallocated
+  _ownsStorage = true;
+}
+
+AvantPinSet::AvantPinSet(const int pinList[], int numPins, uint32_t pwmFrequency, uint8_t pwmResolution,
+                         PinSnapshotMode snapshotMode, PinData* pinStorage, PinTimer* timerStorage, int8_t* slotStorage)
+    : _pins(pinStorage), _pinCount(0), _timerHeap(timerStorage), _timerCount(0), _timerSlot(slotStorage), _ownsStorage(false),
+      _dirtyMask(0), _snapshotMode(snapshotMode), _commandHead(0), _commandTail(0) {
+  memset(_pinIndex, -1, sizeof(_pinIndex));
+  memset(&_stats, 0, sizeof(_stats));
+  pwmResolution = validResolution(pwmResolution);
+  if (pwmFrequency == 0) pwmFrequency = AVANT_PINSET_PWM_FREQUENCY;
+
+  // Each queue slot starts out free for the producer whose turn matches its sequence number
+  for (uint32_t i = 0; i < AVANT_PINSET_QUEUE_SIZE; i++) {
+    _commandQueue[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  // Chain the action pool into the free list
+  for (uint8_t i = 0; i < AVANT_PINSET_ACTION_POOL_SIZE; i++) {
+    _actionPool[i].next = (i + 1 < AVANT_PINSET_ACTION_POOL_SIZE) ? i + 1 : ACTION_NONE;
+  }
+
   for (int i = 0; i < numPins; i++) {
+    // Skip pins the lookup table cannot hold, pins already managed, and pins beyond the status bitmask
+    int slot = pinSlot(pinList[i]);
+    if (_pinCount >= storageSize(numPins) || slot < 0 || _pinIndex[slot] >= 0) {
+      continue;
+    }
+
     PinData pd;
     pd.pinNumber = pinList[i];
-    pd.currentMode = "digital";
+    pd.currentMode = PIN_MODE_DIGITAL;
     pd.currentValue = LOW;
-    pd.isTimerActive = false;
     pd.startTime = 0;
     pd.duration = 0;
     pd.targetValue = 0;
     pd.startPwmValue = 0;
     pd.finishPwmValue = 0;
-    pd.isHoldingBeforeFade = false;
     pd.fadeStartTime = 0;
+    pd.fadeLastTime = 0;
+    pd.fadeAccumulator = 0;
+    pd.fadeStep = 0;
+    pd.fadeDuration = DEFAULT_FADE_MS * 1000ULL;
+    pd.fadeTick = 0;
+    pd.fadeCurve = FADE_LINEAR;
+    pd.hwFadeActive = false;
+    pd.hwFadeDone = false;
+    pd.pwmFrequency = pwmFrequency;
+    pd.pwmResolution = pwmResolution;
+    pd.ledcChannel = LEDC_DETACHED; // Attached by the first PWM write
+    pd.writtenPwm = -1;
+    pd.pendingPwm = 0;
+    if (pd.pinNumber >= AVANT_PINSET_VIRTUAL_PIN_BASE) pd.ledcChannel = LEDC_UNAVAILABLE; // Written through its driver
+    pd.sequence = nullptr;
+    pd.sequenceRepeat = 0;
+    pd.sequenceLength = 0;
+    pd.sequenceStep = 0;
+    pd.pulseEdgeTime = 0;
+    pd.pulseOnUs = 0;
+    pd.pulseOffUs = 0;
+    pd.pulseEdges = 0;
+    pd.pulseLevel = HIGH;
+    pd.pulseOutput = LOW;
+    pd.pulseTimed = false;
+    pd.pulseDone = false;
+    pd.queueHead = ACTION_NONE;
+    pd.queueTail = ACTION_NONE;
+    pd.queueLength = 0;
+    pd.fadeGroup = NO_GROUP;
+    pd.driverChannel = 0;
+    pd.driver = nullptr; // Virtual pins are not driven before attachDriver()
+#if AVANT_PINSET_HAS_ESP_TIMER
+    pd.pulseTimer = nullptr; // Created by the first pulse on this pin
+#endif
     pd.callback = nullptr;
 
-    // Initialize the pin
-    pinMode(pd.pinNumber, OUTPUT);
-    digitalWrite(pd.pinNumber, pd.currentValue);
+    // Report the pin in the first delta
+    _timerSlot[_pinCount] = -1;
+    _pinIndex[slot] = (int8_t)_pinCount;
+    markDirty(_pinCount);
+    _pins[_pinCount++] = pd;
+  }
+
+  _pinListHash = fnv1a(nullptr, 0);
+  for (size_t i = 0; i < _pinCount; i++) {
+    uint8_t gpio = (uint8_t)_pins[i].pinNumber;
+    _pinListHash = fnv1a(&gpio, 1, _pinListHash);
+  }
+
+  // Look for a snapshot of this pin list: in RTC memory first, then in NVS after a power loss
+  const uint8_t* snapshot = (const uint8_t*)rtcSnapshot;
+  int entries = -1;
+  if (_snapshotMode != SNAPSHOT_OFF) {
+    entries = snapshotEntries(snapshot, sizeof(rtcSnapshot));
+    if (entries >= 0 && snapshotHeader(snapshot).pinListHash != _pinListHash) entries = -1;
+#if defined(ARDUINO_ARCH_ESP32)
+    if (entries < 0 && _snapshotMode == SNAPSHOT_NVS) {
+      SnapshotNvs nvs(_pinListHash, NVS_READONLY);
+      entries = snapshotEntries(snapshot, nvs.read((uint8_t*)rtcSnapshot, sizeof(rtcSnapshot)));
+      if (entries >= 0 && snapshotHeader(snapshot).pinListHash != _pinListHash) entries = -1;
+      if (entries >= 0) _snapshotNvsHash = snapshotHeader(snapshot).checksum; // Flash already holds it
+    }
+#endif
+  }
+
+  // Initialize the pins, in their restored state or LOW
+  for (size_t i = 0; i < _pinCount; i++) {
+    const uint8_t* entry = nullptr;
+    for (int e = 0; e < entries && !entry; e++) {
+      const uint8_t* candidate = snapshot + sizeof(SnapshotHeader) + e * sizeof(SnapshotEntry);
+      if (candidate[offsetof(SnapshotEntry, pinNumber)] == _pins[i].pinNumber) entry = candidate;
+    }
+
+    if (entry) {
+      restorePin((uint8_t)i, entry, true);
+    } else {
+      setDigitalOutput(_pins[i]);
+      writeDigital(_pins[i], _pins[i].currentValue);
+    }
+  }
+}
+
+AvantPinSet::~AvantPinSet() {
+#if AVANT_PINSET_HAS_ESP_TIMER
+  // The timers point into the pin table, so they must go before it does
+  for (size_t i = 0; i < _pinCount; i++) {
+    if (!_pins[i].pulseTimer) continue;
+    stopPulse(_pins[i]);
+    esp_timer_delete(_pins[i].pulseTimer);
+  }
+#endif
 
-    _pins.push_back(pd);
+  if (_ownsStorage) {
+    delete[] _pins;
+    delete[] _timerHeap;
+    delete[] _timerSlot;
   }
 }
 
+size_t AvantPinSet::storageSize(int numPins) {
+  // At most one timer per pin, so the timer heap needs no more slots than the pin table
+  if (numPins < 0) return 0;
+  return ((size_t)numPins < AVANT_PINSET_MAX_PINS) ? (size_t)numPins : AVANT_PINSET_MAX_PINS;
+}
+
 // The main update loop, must be called from the sketch's loop()
 void AvantPinSet::update() {
-  unsigned long currentMillis = millis();
-
-  for (auto& pin : _pins) {
-    if (pin.isTimerActive) {
-      if (pin.currentMode == "fading" && pin.isHoldingBeforeFade) {
-        // Check if the holding period is over
-        if (currentMillis - pin.startTime >= pin.duration) {
-          // Holding period is over, start the actual fade
-          pin.isHoldingBeforeFade = false;
-          pin.fadeStartTime = currentMillis;
-          // Use a default fade duration of 1 second (1000ms)
-          pin.duration = 1000UL;
-          // Don't deactivate the timer, we need it for the fade
-        }
-        // During holding period, just maintain the start PWM value
-        analogWrite(pin.pinNumber, pin.startPwmValue);
-      } else if (pin.currentMode == "fading" && !pin.isHoldingBeforeFade) {
-        // We're in the actual fading phase
-        unsigned long elapsed = currentMillis - pin.fadeStartTime;
-        
-        if (elapsed >= pin.duration) {
-          // Fading is complete, set the final value
-          pin.currentValue = pin.finishPwmValue;
-          analogWrite(pin.pinNumber, pin.currentValue);
-          pin.currentMode = "pwm"; // Mode becomes standard PWM after fade
-          pin.isTimerActive = false; // Deactivate timer after fade is complete
-          
-          // Execute callback if one was provided
-          if (pin.callback) {
-            pin.callback(pin.pinNumber);
-            pin.callback = nullptr; // Clear callback after execution
-          }
-        } else {
-          // Still fading, calculate the current PWM value based on elapsed time
-          float progress = (float)elapsed / pin.duration;
-          int currentPwmValue = pin.startPwmValue + (progress * (pin.finishPwmValue - pin.startPwmValue));
-          analogWrite(pin.pinNumber, currentPwmValue);
-        }
-      } else if (currentMillis - pin.startTime >= pin.duration) {
-        // Timer has finished for non-fading modes, execute the action
-        pin.isTimerActive = false; // Deactivate timer first
-
-        if (pin.currentMode == "digital") {
-          // Standard timed action (digital)
-          pin.currentValue = pin.targetValue;
-          digitalWrite(pin.pinNumber, pin.currentValue);
-        } else if (pin.currentMode == "pwm") {
-          // Standard timed action (PWM)
-          pin.currentValue = pin.targetValue;
-          analogWrite(pin.pinNumber, pin.currentValue);
-        }
+  AVANT_PINSET_PROFILE(PROFILE_UPDATE);
+  TaskLock lock(this);
+  uint64_t startMicros = clockMicros();
+  _stats.updateCalls++;
 
-        // Execute callback if one was provided
-        if (pin.callback) {
-          pin.callback(pin.pinNumber);
-          pin.callback = nullptr; // Clear callback after execution
-        }
-      }
+  // Apply commands queued from other tasks first, they may schedule new timers
+  drainCommands();
+
+  // Wall-clock rules come due rarely, so this is one comparison on most calls
+  if (_ruleCount > 0 && startMicros >= _ruleDeadline) runRules(startMicros);
+
+  // Nothing is scheduled, so there is nothing to do
+  if (_timerCount == 0) {
+    serviceSnapshot(startMicros);
+    return;
+  }
+
+  uint64_t currentMicros = clockMicros();
+
+  // Service timers in deadline order until the earliest one is not due yet. The deadlines
+  // live in the heap itself, so this check never touches the pin table.
+  // The budget keeps a callback that reschedules its own pin for "now" from
+  // spinning here; such a timer runs on the next call instead.
+  size_t budget = _timerCount;
+  while (budget-- > 0 && _timerCount > 0) {
+    if (_timerHeap[0].deadline > currentMicros) break;
+    uint64_t lateness = currentMicros - _timerHeap[0].deadline;
+    if (lateness > _stats.maxLatenessMicros) _stats.maxLatenessMicros = (lateness > UINT32_MAX) ? UINT32_MAX : (uint32_t)lateness;
+    _serviceLateness = (lateness > UINT32_MAX) ? UINT32_MAX : (uint32_t)lateness;
+    runTimer(_timerHeap[0].index, currentMicros);
+  }
+  _serviceLateness = 0;
+
+  uint64_t elapsedMicros = clockMicros() - startMicros;
+  if (elapsedMicros > _stats.maxUpdateMicros) _stats.maxUpdateMicros = (elapsedMicros > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsedMicros;
+
+  // Outside the timed part, an NVS write can take several milliseconds
+  serviceSnapshot(startMicros + elapsedMicros);
+}
+
+unsigned long AvantPinSet::nextDeadlineMs() const {
+  uint64_t remaining = nextDeadlineUs();
+  if (remaining == NO_DEADLINE_US) return NO_DEADLINE;
+
+  // Round up, so sleeping for the returned time never wakes before the deadline
+  uint64_t ms = (remaining + 999) / 1000;
+  return (ms < NO_DEADLINE) ? (unsigned long)ms : NO_DEADLINE - 1;
+}
+
+uint64_t AvantPinSet::nextDeadlineUs() const {
+  TaskLock lock(this);
+  uint64_t deadline = snapshotDeadline();
+  if (_timerCount > 0 && _timerHeap[0].deadline < deadline) deadline = _timerHeap[0].deadline;
+  if (_ruleCount > 0 && _ruleDeadline < deadline) deadline = _ruleDeadline;
+  if (deadline == NO_DEADLINE_US) return NO_DEADLINE_US;
+
+  uint64_t now = clockMicros();
+  return (deadline > now) ? deadline - now : 0;
+}
+
+bool AvantPinSet::sleepUntilNextEvent(uint64_t maxSleepUs) {
+#if AVANT_PINSET_HAS_FREERTOS
+  if (_taskHandle) return false; // The task already sleeps between deadlines
+#endif
+  uint64_t waitUs = min(nextDeadlineUs(), maxSleepUs);
+  if (waitUs == NO_DEADLINE_US) return false; // Nothing would end the wait
+  uint64_t wakeTime = clockMicros() + waitUs;
+  bool slept = false;
+
+  if (waitUs >= AVANT_PINSET_MIN_SLEEP_US && outputsSteady()) {
+    holdOutputs(true);
+    AvantPinSetHal::SleepWakeup wakeup = AvantPinSetHal::lightSleep(waitUs - AVANT_PINSET_SLEEP_WAKEUP_US);
+    holdOutputs(false);
+    slept = (wakeup != AvantPinSetHal::SLEEP_UNAVAILABLE);
+
+    // Woken by the sketch's own source, hand control back right away
+    if (wakeup == AvantPinSetHal::SLEEP_WOKE_OTHER) {
+      update();
+      return true;
     }
   }
+
+  // Wait out the time to the deadline, then catch up on everything that came due meanwhile
+  uint64_t now = clockMicros();
+  if (now < wakeTime) AvantPinSetHal::delayMicros64(wakeTime - now);
+  update();
+  return slept;
 }
 
-// --- Private Helper ---
-PinData* AvantPinSet::findPinData(int pinNum) {
-  for (auto& pin : _pins) {
-    if (pin.pinNumber == pinNum) {
-      return &pin;
+// --- Command Queue ---
+bool AvantPinSet::postCommand(const PinCommand& command) {
+  uint32_t pos = _commandHead.load(std::memory_order_relaxed);
+
+  for (;;) {
+    CommandSlot& slot = _commandQueue[pos & (AVANT_PINSET_QUEUE_SIZE - 1)];
+    int32_t diff = (int32_t)(slot.seq.load(std::memory_order_acquire) - pos);
+
+    if (diff == 0) {
+      // The slot is free for this position, try to claim it
+      if (_commandHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        slot.command = command;
+        slot.seq.store(pos + 1, std::memory_order_release); // Publish to the consumer
+        break;
+      }
+    } else if (diff < 0) {
+      return false; // The consumer has not drained this slot yet, the queue is full
+    } else {
+      pos = _commandHead.load(std::memory_order_relaxed); // Another producer got there first
+    }
+  }
+
+#if AVANT_PINSET_HAS_FREERTOS
+  // Wake the scheduler task so the command is applied right away
+  if (_taskHandle) {
+    if (xPortInIsrContext()) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(_taskHandle, &woken);
+      if (woken) portYIELD_FROM_ISR();
+    } else {
+      xTaskNotifyGive(_taskHandle);
     }
   }
-  return nullptr; // Pin not found
+#endif
+  return true;
 }
 
-// --- Core Digital Methods ---
-void AvantPinSet::digitalSet(int pinNum, int state) {
-  PinData* pin = findPinData(pinNum);
-  if (!pin) return;
+void AvantPinSet::drainCommands() {
+  PinCommand batch[AVANT_PINSET_QUEUE_SIZE];
+  size_t count = 0;
 
-  // Cancel any ongoing timed action for this pin
-  pin->isTimerActive = false;
-  pin->callback = nullptr;
+  // Bounded by the queue size, so producers that keep posting cannot starve the timers
+  while (count < AVANT_PINSET_QUEUE_SIZE) {
+    CommandSlot& slot = _commandQueue[_commandTail & (AVANT_PINSET_QUEUE_SIZE - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != _commandTail + 1) break; // Nothing published yet
 
-  // If switching from PWM mode to digital mode, reconfigure the pin
-  if (pin->currentMode == "pwm" || pin->currentMode == "fading") {
-    pinMode(pin->pinNumber, OUTPUT);
+    batch[count++] = slot.command;
+    // Hand the slot back to producers for the next lap around the ring
+    slot.seq.store(_commandTail + AVANT_PINSET_QUEUE_SIZE, std::memory_order_release);
+    _commandTail++;
   }
 
-  pin->currentMode = "digital";
-  pin->currentValue = (state == HIGH) ? HIGH : LOW;
-  digitalWrite(pin->pinNumber, pin->currentValue);
+  if (count > 0) applyBatch(batch, count);
 }
 
-void AvantPinSet::digitalSetTime(int pinNum, int state, unsigned long delaySeconds, TimedActionCallback callback) {
-  PinData* pin = findPinData(pinNum);
-  if (!pin) return;
+void AvantPinSet::applyCommand(const PinCommand& command) {
+  PinHandle handle = getHandle(command.pinNumber);
 
-  // If switching from PWM mode to digital mode, reconfigure the pin
-  if (pin->currentMode == "pwm" || pin->currentMode == "fading") {
-    pinMode(pin->pinNumber, OUTPUT);
+  switch (command.type) {
+    case PIN_CMD_DIGITAL_SET:
+      digitalSet(handle, command.value);
+      break;
+    case PIN_CMD_DIGITAL_SET_TIME:
+      digitalSetTime(handle, command.value, command.time);
+      break;
+    case PIN_CMD_PWM_SET:
+      pwmSet(handle, command.value);
+      break;
+    case PIN_CMD_PWM_SET_TIME:
+      pwmSetTime(handle, command.value, command.time);
+      break;
+    case PIN_CMD_PWM_FADE:
+      pwmFade(handle, command.value, command.value2);
+      break;
+    case PIN_CMD_PWM_FADE_TIME:
+      pwmFadeTime(handle, command.value, command.value2, command.time);
+      break;
   }
+}
 
-  // 1. Set the pin to the target state immediately
-  pin->currentMode = "digital";
-  pin->currentValue = (state == HIGH) ? HIGH : LOW;
-  digitalWrite(pin->pinNumber, pin->currentValue);
+// --- Action Queues ---
+bool AvantPinSet::queueAction(const PinCommand& command, PinCallback callback, PinQueueMode mode) {
+  TaskLock lock(this);
+  PinHandle handle = getHandle(command.pinNumber);
+  PinData* pin = handleData(handle);
+  if (!pin || command.type > PIN_CMD_PWM_FADE_TIME) return false;
 
-  // 2. Configure the timer to revert to the opposite state after delaySeconds
-  pin->isTimerActive = true;
-  pin->startTime = millis();
-  pin->duration = delaySeconds * 1000UL;  // Convert seconds to milliseconds
-  pin->targetValue = (state == HIGH) ? LOW : HIGH;  // Revert to opposite state
-  pin->callback = callback;
+  if (mode != QUEUE_APPEND) dropQueuedActions(*pin);
+
+  // Nothing to wait for, so the action starts now and needs no pool entry
+  if (mode == QUEUE_REPLACE_ALL || (pin->queueLength == 0 && _timerSlot[handle.index] < 0)) {
+    startAction(handle.index, command, std::move(callback));
+    return true;
+  }
+
+  if (pin->queueLength >= AVANT_PINSET_PIN_QUEUE_DEPTH || _actionFree == ACTION_NONE) return false;
+
+  uint8_t slot = _actionFree;
+  PinQueuedAction& action = _actionPool[slot];
+  _actionFree = action.next;
+  action.command = command;
+  action.callback = std::move(callback);
+  action.next = ACTION_NONE;
+
+  if (pin->queueLength == 0) {
+    pin->queueHead = slot;
+  } else {
+    _actionPool[pin->queueTail].next = slot;
+  }
+  pin->queueTail = slot;
+  pin->queueLength++;
+  return true;
 }
 
+uint8_t AvantPinSet::queuedActions(int pinNum) const {
+  return queuedActions(getHandle(pinNum));
+}
 
-// --- Core PWM Methods ---
-void AvantPinSet::pwmSet(int pinNum, int pwmValue) {
-  PinData* pin = findPinData(pinNum);
-  if (!pin) return;
+uint8_t AvantPinSet::queuedActions(PinHandle handle) const {
+  TaskLock lock(this);
+  if (handle.index < 0 || handle.index >= (int)_pinCount) return 0;
+  return _pins[handle.index].queueLength;
+}
 
-  // Constrain PWM value to be safe
-  pwmValue = constrain(pwmValue, 0, 255);
+uint8_t AvantPinSet::cancelQueuedActions(int pinNum) {
+  return cancelQueuedActions(getHandle(pinNum));
+}
 
-  // Cancel any ongoing timed action
-  pin->isTimerActive = false;
-  pin->callback = nullptr;
+uint8_t AvantPinSet::cancelQueuedActions(PinHandle handle) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  return pin ? dropQueuedActions(*pin) : 0;
+}
 
-  pin->currentMode = "pwm";
-  pin->currentValue = pwmValue;
-  analogWrite(pin->pinNumber, pin->currentValue);
+void AvantPinSet::startAction(uint8_t index, const PinCommand& command, PinCallback callback) {
+  PinData& pin = _pins[index];
+
+  // Detach the waiting actions while the command starts; as a direct call, it would drop them
+  uint8_t head = pin.queueHead;
+  uint8_t tail = pin.queueTail;
+  uint8_t length = pin.queueLength;
+  pin.queueHead = ACTION_NONE;
+  pin.queueTail = ACTION_NONE;
+  pin.queueLength = 0;
+
+  applyCommand(command);
+
+  pin.queueHead = head;
+  pin.queueTail = tail;
+  pin.queueLength = length;
+
+  // A timed command owns the pin until its timer completes; anything else is complete already
+  pin.callback = std::move(callback);
+  if (_timerSlot[index] < 0) completeAction(index, PIN_EVENT_IMMEDIATE);
 }
 
-void AvantPinSet::pwmSetTime(int pinNum, int pwmValue, unsigned long delaySeconds, TimedActionCallback callback) {
-  PinData* pin = findPinData(pinNum);
-  if (!pin) return;
+void AvantPinSet::runQueuedActions(uint8_t index) {
+  PinData& pin = _pins[index];
 
-  pwmValue = constrain(pwmValue, 0, 255);
+  // Start the next action, unless a callback has already given the pin something to do
+  if (pin.queueLength == 0 || _timerSlot[index] >= 0) return;
 
-  // 1. Set PWM value immediately
-  pin->currentMode = "pwm";
-  pin->currentValue = pwmValue;
-  analogWrite(pin->pinNumber, pin->currentValue);
+  uint8_t slot = pin.queueHead;
+  PinQueuedAction& action = _actionPool[slot];
+  PinCommand command = action.command;
+  PinCallback callback = std::move(action.callback);
+  action.callback = nullptr;
 
-  // 2. Schedule revert to opposite state after delaySeconds
-  pin->isTimerActive = true;
-  pin->startTime = millis();
-  pin->duration = delaySeconds * 1000UL;
-  pin->targetValue = (pin->currentValue == 0) ? 255 : 0; // Revert logic (adjust as needed)
-  pin->callback = callback;
+  pin.queueHead = action.next;
+  if (--pin.queueLength == 0) pin.queueTail = ACTION_NONE;
+  action.next = _actionFree;
+  _actionFree = slot;
+
+  startAction(index, command, std::move(callback));
 }
 
-void AvantPinSet::pwmFade(int pinNum, int beginPwmValue, int finishPwmValue) {
-  PinData* pin = findPinData(pinNum);
-  if (!pin) return;
+uint8_t AvantPinSet::dropQueuedActions(PinData& pin) {
+  uint8_t dropped = pin.queueLength;
 
-  beginPwmValue = constrain(beginPwmValue, 0, 255);
-  finishPwmValue = constrain(finishPwmValue, 0, 255);
+  // Hand the entries back to the pool
+  while (pin.queueLength > 0) {
+    uint8_t slot = pin.queueHead;
+    pin.queueHead = _actionPool[slot].next;
+    _actionPool[slot].callback = nullptr;
+    _actionPool[slot].next = _actionFree;
+    _actionFree = slot;
+    pin.queueLength--;
+  }
+  pin.queueHead = ACTION_NONE;
+  pin.queueTail = ACTION_NONE;
+  return dropped;
+}
 
-  pin->currentMode = "fading";
-  pin->isTimerActive = true;
-  pin->startTime = millis();
-  pin->duration = 1000UL;  // Default fade time of 1 second
-  pin->startPwmValue = beginPwmValue;
-  pin->finishPwmValue = finishPwmValue;
-  pin->currentValue = beginPwmValue; // Set current value to start value
-  pin->isHoldingBeforeFade = false;  // Start fading immediately
-  pin->fadeStartTime = millis();     // Set fade start time to now
+void AvantPinSet::completeAction(uint8_t index, PinEventType type) {
+#if AVANT_PINSET_HAS_FREERTOS
+  if (_eventQueue) {
+    // Posted before the callback runs, so the event carries the value the action left
+    PinEvent event;
+    event.timeUs = clockMicros();
+    event.latenessUs = _serviceLateness;
+    event.value = (uint16_t)_pins[index].currentValue;
+    event.pinNumber = (uint8_t)_pins[index].pinNumber;
+    event.type = type;
+    if (xQueueSend(_eventQueue, &event, 0) != pdTRUE) _stats.eventsDropped++;
+  }
+#else
+  (void)type;
+#endif
+  fireCallback(_pins[index]);
+  runQueuedActions(index);
+}
+
+// --- Scheduler Task ---
+bool AvantPinSet::beginTask(int core, unsigned int priority, uint32_t stackSize) {
+#if AVANT_PINSET_HAS_FREERTOS
+  if (_taskHandle) return true; // Already running
 
-  // Set the initial PWM value immediately
-  analogWrite(pin->pinNumber, pin->startPwmValue);
+  if (!_taskLock) {
+    // Recursive, so callbacks running inside update() may call back into this instance
+    _taskLock = xSemaphoreCreateRecursiveMutex();
+    if (!_taskLock) return false;
+  }
+
+  return xTaskCreatePinnedToCore(taskEntry, "AvantPinSet", stackSize, this, priority, &_taskHandle, core) == pdPASS;
+#else
+  (void)core;
+  (void)priority;
+  (void)stackSize;
+  return false;
+#endif
 }
 
-void AvantPinSet::pwmFadeTime(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds, TimedActionCallback callback) {
-  PinData* pin = findPinData(pinNum);
-  if (!pin) return;
+void AvantPinSet::endTask() {
+#if AVANT_PINSET_HAS_FREERTOS
+  // The task cannot stop itself from inside a callback
+  if (!_taskHandle || xTaskGetCurrentTaskHandle() == _taskHandle) return;
 
-  beginPwmValue = constrain(beginPwmValue, 0, 255);
-  finishPwmValue = constrain(finishPwmValue, 0, 255);
+  // Hold the lock so the task is not stopped halfway through update()
+  TaskLock lock(this);
+  vTaskDelete(_taskHandle);
+  _taskHandle = nullptr;
+#endif
+}
 
-  pin->currentMode = "fading";
-  pin->isTimerActive = true;
-  pin->startTime = millis();
-  pin->duration = holdTimeSeconds * 1000UL;  // This is now the holding time
-  pin->startPwmValue = beginPwmValue;
-  pin->finishPwmValue = finishPwmValue;
-  pin->currentValue = beginPwmValue; // Set current value to start value
-  pin->isHoldingBeforeFade = true;   // We're holding before fading
-  pin->fadeStartTime = 0;            // Will be set when fade starts
-  pin->callback = callback;
+#if AVANT_PINSET_HAS_FREERTOS
+void AvantPinSet::setEventQueue(QueueHandle_t queue) {
+  TaskLock lock(this);
+  _eventQueue = queue;
+}
+#endif
+
+void AvantPinSet::taskEntry(void* arg) {
+#if AVANT_PINSET_HAS_FREERTOS
+  AvantPinSet* self = static_cast<AvantPinSet*>(arg);
+
+  for (;;) {
+    self->update();
 
-  // Set the initial PWM value immediately
-  analogWrite(pin->pinNumber, pin->startPwmValue);
+    // Block until the next deadline, or until scheduleTimer() notifies us of an earlier one
+    unsigned long waitMs = self->nextDeadlineMs();
+    TickType_t ticks = (waitMs == NO_DEADLINE) ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+    ulTaskNotifyTake(pdTRUE, ticks);
+  }
+#else
+  (void)arg;
+#endif
 }
 
-// --- Status Methods ---
-String AvantPinSet::systemStatus() {
-  JsonDocument doc;
-  for (const auto& pin : _pins) {
-    String key = String(pin.pinNumber);
-    String value = (pin.currentMode == "digital") ? (pin.currentValue == HIGH ? "HIGH" : "LOW") : String(pin.currentValue);
-    doc[key] = value;
+AvantPinSet::TaskLock::TaskLock(const AvantPinSet* owner) : _owner(owner) {
+#if AVANT_PINSET_HAS_FREERTOS
+  if (_owner->_taskLock) xSemaphoreTakeRecursive(_owner->_taskLock, portMAX_DELAY);
+#endif
+  _owner->_lockDepth++;
+}
+
+AvantPinSet::TaskLock::~TaskLock() {
+  // Send the writes of the whole operation together, before another task can start one.
+  // Only non-const methods hold back PWM writes, so the owner is not const when there are any.
+  if (--_owner->_lockDepth == 0) {
+    if (_owner->_pwmPending) const_cast<AvantPinSet*>(_owner)->writePendingPwm();
+    if (_owner->_driverCount > 0) _owner->flushDrivers();
   }
+#if AVANT_PINSET_HAS_FREERTOS
+  if (_owner->_taskLock) xSemaphoreGiveRecursive(_owner->_taskLock);
+#endif
+}
 
-  String output;
-  serializeJson(doc, output);
-  return output;
+// --- Scheduler ---
+void AvantPinSet::runTimer(uint8_t index, uint64_t currentMicros) {
+  PinData& pin = _pins[index];
+
+  switch (pin.currentMode) {
+    case PIN_MODE_HOLD:
+      // Holding period is over, start the actual fade
+      pin.duration = pin.fadeDuration;
+      beginFade(index, currentMicros);
+      break;
+
+    case PIN_MODE_FADING: {
+      if (pin.fadeGroup != NO_GROUP) {
+        // The pin carries the timer of a group fade, which steps all members at once
+        runGroupFade(index, currentMicros);
+        break;
+      }
+
+      // We're in the actual fading phase
+      uint64_t elapsed = currentMicros - pin.fadeStartTime;
+
+      if (pin.hwFadeActive) {
+        // The LEDC peripheral owns the ramp, wait for its fade-end interrupt
+        if (!pin.hwFadeDone && elapsed < pin.duration + HW_FADE_GRACE_US) {
+          scheduleTimer(index, currentMicros + HW_FADE_POLL_US);
+          break;
+        }
+        pin.hwFadeActive = false;
+        elapsed = pin.duration;
+      }
+
+      if (elapsed >= pin.duration) {
+        // Fading is complete, set the final value
+        pin.currentValue = pin.finishPwmValue;
+        writePwm(pin, pin.currentValue);
+        if (pin.sequence) {
+          // The keyframe is reached, the next one starts where this fade was planned to end
+          markDirty(index);
+          runSequenceStep(index, pin.fadeStartTime + pin.duration);
+          break;
+        }
+        pin.currentMode = PIN_MODE_PWM; // Mode becomes standard PWM after fade
+        markDirty(index);
+        cancelTimer(index); // Deactivate timer after fade is complete
+        completeAction(index, PIN_EVENT_FADE);
+      } else {
+        // Still fading, advance the 32.32 fixed-point ramp by the microseconds since the last step
+        AVANT_PINSET_PROFILE(PROFILE_FADE_STEP);
+        pin.fadeAccumulator += pin.fadeStep * (currentMicros - pin.fadeLastTime);
+        pin.fadeLastTime = currentMicros;
+        writePwm(pin, fadeValue(pin));
+        // Come back after one tick, but no later than the end of the fade
+        uint64_t fadeEnd = pin.fadeStartTime + pin.duration;
+        scheduleTimer(index, min(currentMicros + pin.fadeTick, fadeEnd));
+      }
+      break;
+    }
+
+    case PIN_MODE_SEQUENCE:
+      // The keyframe has been held long enough, start the next one
+      runSequenceStep(index, _timerHeap[_timerSlot[index]].deadline);
+      break;
+
+    case PIN_MODE_PULSE:
+      if (pin.pulseTimed) {
+        // The esp_timer callback writes the edges, wait for it to report the last one
+        if (!pin.pulseDone) {
+          scheduleTimer(index, currentMicros + PULSE_POLL_US);
+          break;
+        }
+      } else if (advancePulse(pin)) {
+        // No hardware timer, so update() writes the edges itself
+        scheduleTimer(index, pin.pulseEdgeTime);
+        break;
+      }
+
+      // The last edge is written, the pin is back at its idle level
+      pin.currentMode = PIN_MODE_DIGITAL;
+      markDirty(index);
+      cancelTimer(index);
+      completeAction(index, PIN_EVENT_PULSE);
+      break;
+
+    default:
+      // Timer has finished for non-fading modes, execute the action
+      cancelTimer(index); // Deactivate timer first
+
+      if (pin.currentMode == PIN_MODE_DIGITAL) {
+        // Standard timed action (digital)
+        pin.currentValue = pin.targetValue;
+        writeDigital(pin, pin.currentValue);
+      } else if (pin.currentMode == PIN_MODE_PWM) {
+        // Standard timed action (PWM)
+        pin.currentValue = pin.targetValue;
+        writePwm(pin, pin.currentValue);
+      }
+      markDirty(index);
+
+      completeAction(index, PIN_EVENT_TIMER);
+      break;
+  }
 }
 
-String AvantPinSet::pinStatus(int pinNum) {
-  JsonDocument doc;
-  PinData* pin = findPinData(pinNum);
+void AvantPinSet::stopAction(PinData& pin) {
+  stopHardwareFade(pin);
+  stopPulse(pin);
+  pin.sequence = nullptr;
+  pin.callback = nullptr; // The new action brings its own callback, if any
+  if (pin.fadeGroup != NO_GROUP) leaveGroupFade(pin);
+  dropQueuedActions(pin); // A direct call replaces everything planned for the pin
+}
 
-  if (pin) {
-    doc["mode"] = pin->currentMode;
-    String valueStr = (pin->currentMode == "digital") ? (pin->currentValue == HIGH ? "HIGH" : "LOW") : String(pin->currentValue);
-    doc["value"] = valueStr;
+void AvantPinSet::runSequenceStep(uint8_t index, uint64_t stepStart) {
+  PinData& pin = _pins[index];
+
+  if (pin.sequenceStep >= pin.sequenceLength) {
+    if (pin.sequenceRepeat == 1) {
+      // Last pass is done, the pin keeps the final keyframe value
+      pin.sequence = nullptr;
+      pin.currentMode = PIN_MODE_PWM;
+      markDirty(index);
+      cancelTimer(index);
+      completeAction(index, PIN_EVENT_SEQUENCE);
+      return;
+    }
+    if (pin.sequenceRepeat > 1) pin.sequenceRepeat--;
+    pin.sequenceStep = 0;
+  }
+
+  const PinKeyframe& keyframe = pin.sequence[pin.sequenceStep++];
+  int value = min((int)keyframe.value, maxDuty(pin));
+  pin.startTime = stepStart;
+
+  if (keyframe.curve > FADE_CIE || keyframe.timeMs == 0) {
+    // Step keyframe: jump to the value and hold it
+    pin.currentMode = PIN_MODE_SEQUENCE;
+    pin.currentValue = value;
+    writePwm(pin, value);
+    markDirty(index);
+    scheduleTimer(index, stepStart + keyframe.timeMs * 1000ULL);
+    return;
+  }
+
+  // Fade keyframe: ramp from the value the pin is at now
+  pin.startPwmValue = pin.currentValue;
+  pin.finishPwmValue = value;
+  pin.duration = keyframe.timeMs * 1000ULL;
+  pin.fadeDuration = pin.duration;
+  pin.fadeCurve = (FadeCurve)keyframe.curve;
+  beginFade(index, stepStart);
+}
+
+void AvantPinSet::beginFade(uint8_t index, uint64_t currentMicros) {
+  PinData& pin = _pins[index];
+  pin.currentMode = PIN_MODE_FADING;
+  pin.fadeStartTime = currentMicros;
+
+#if AVANT_PINSET_HAS_LEDC_FADE
+  if (_hardwareFade && pin.fadeCurve == FADE_LINEAR && !isVirtual(pin)) {
+    // Hand the ramp to the LEDC peripheral and check back when it should be done
+    pin.hwFadeDone = false;
+    // The fade engine works in milliseconds, sub-millisecond fades are left to the software ramp
+    int durationMs = (int)min(pin.duration / 1000, (uint64_t)INT_MAX);
+    if (durationMs > 0 && ledcFadeWithInterruptArg(pin.pinNumber, pin.startPwmValue, pin.finishPwmValue, durationMs, onHardwareFadeDone, &pin)) {
+      pin.hwFadeActive = true;
+      forgetPwm(pin); // The fade engine moves the duty from here on
+      scheduleTimer(index, currentMicros + pin.duration);
+      return;
+    }
+    // The peripheral refused the fade, fall back to the software ramp
+  }
+  // The LEDC fade engine is linear only, eased curves always use the software ramp
+#endif
+
+  // Precompute the per-microsecond step in 32.32 fixed point, rounded to nearest, so
+  // each tick is a multiply-add and the ramp stays integer-only. The final value is written exactly.
+  // Linear fades step through PWM values; eased fades step through the 0-255 curve table.
+  uint64_t delta = (pin.fadeCurve == FADE_LINEAR) ? fadeDistance(pin) : 255;
+  pin.fadeStep = (pin.duration > 0) ? ((delta << 32) + pin.duration / 2) / pin.duration : 0;
+  pin.fadeAccumulator = 0;
+  pin.fadeLastTime = currentMicros;
+
+  // Tick about once per output step; eased curves get extra ticks for their steepest part
+  uint64_t steps = (uint64_t)fadeDistance(pin) * ((pin.fadeCurve == FADE_LINEAR) ? 1 : 4);
+  uint64_t tick = (steps > 0) ? pin.duration / steps : pin.duration;
+  pin.fadeTick = (uint32_t)constrain(tick, (uint64_t)AVANT_PINSET_MIN_FADE_TICK_US, (uint64_t)UINT32_MAX);
+
+  // The start value is already on the pin, come back after one tick to advance the fade
+  scheduleTimer(index, min(currentMicros + pin.fadeTick, currentMicros + pin.duration));
+}
+
+uint32_t AvantPinSet::fadeDistance(const PinData& pin) {
+  return (pin.finishPwmValue > pin.startPwmValue) ? pin.finishPwmValue - pin.startPwmValue
+                                                  : pin.startPwmValue - pin.finishPwmValue;
+}
+
+int AvantPinSet::fadeValue(const PinData& pin) {
+  uint32_t offset;
+
+  if (pin.fadeCurve == FADE_LINEAR) {
+    // The accumulator already holds the distance travelled
+    offset = (uint32_t)((pin.fadeAccumulator + 0x80000000ULL) >> 32);
   } else {
-    // Return an error or empty object if pin not found
-    doc["error"] = "Pin not managed by this instance";
+    // The accumulator holds the table position; interpolate between neighbouring entries.
+    // Brightness curves are mirrored when fading down, so the output still follows the
+    // curve from dark to bright rather than lingering at full brightness.
+    const uint16_t* table = curveTable(pin.fadeCurve);
+    bool mirrored = (pin.fadeCurve == FADE_GAMMA || pin.fadeCurve == FADE_CIE) && pin.finishPwmValue < pin.startPwmValue;
+    uint32_t accumulator = (uint32_t)min(pin.fadeAccumulator >> 16, (uint64_t)255 << 16);
+    if (mirrored) accumulator = ((uint32_t)255 << 16) - accumulator;
+
+    uint32_t position = accumulator >> 16;
+    uint32_t eased = table[255];
+    if (position < 255) {
+      uint32_t fraction = accumulator & 0xFFFFUL;
+      eased = table[position] + (((uint32_t)(table[position + 1] - table[position]) * fraction) >> 16);
+    }
+    if (mirrored) eased = 65535UL - eased;
+    offset = (fadeDistance(pin) * eased + 0x8000UL) >> 16;
   }
 
-  String output;
-  serializeJson(doc, output);
-  return output;
+  // Round the accumulated offset to the nearest step and never overshoot the finish value
+  if (pin.finishPwmValue >= pin.startPwmValue) {
+    return min(pin.startPwmValue + (int)offset, pin.finishPwmValue);
+  }
+  return max(pin.startPwmValue - (int)offset, pin.finishPwmValue);
+}
+
+const uint16_t* AvantPinSet::curveTable(FadeCurve curve) {
+  switch (curve) {
+    case FADE_GAMMA:
+      return FADE_TABLE_GAMMA;
+    case FADE_EASE_IN:
+      return FADE_TABLE_EASE_IN;
+    case FADE_EASE_OUT:
+      return FADE_TABLE_EASE_OUT;
+    case FADE_EASE_IN_OUT:
+      return FADE_TABLE_EASE_IN_OUT;
+    default:
+      return FADE_TABLE_CIE;
+  }
+}
+
+void AvantPinSet::stopHardwareFade(PinData& pin) {
+  if (!pin.hwFadeActive) return;
+  pin.hwFadeActive = false;
+  forgetPwm(pin); // Stopped somewhere along the ramp
+
+#if AVANT_PINSET_HAS_LEDC_FADE && SOC_LEDC_SUPPORT_FADE_STOP
+  // The core assigns LEDC channels in groups of 8 per speed mode
+  int channel = pin.ledcChannel;
+  if (channel < 0) {
+    ledc_channel_handle_t* bus = (ledc_channel_handle_t*)perimanGetPinBus(pin.pinNumber, ESP32_BUS_TYPE_LEDC);
+    if (!bus) return;
+    channel = bus->channel;
+  }
+  ledc_fade_stop((ledc_mode_t)(channel / 8), (ledc_channel_t)(channel % 8));
+#endif
+}
+
+bool AvantPinSet::outputsSteady() const {
+  TaskLock lock(this);
+  for (size_t i = 0; i < _pinCount; i++) {
+    const PinData& pin = _pins[i];
+    // Virtual pins keep their outputs in their own device
+    if (isVirtual(pin) || pin.currentMode == PIN_MODE_IDLE || pin.currentMode == PIN_MODE_DIGITAL) continue;
+    if (pin.currentMode == PIN_MODE_FADING || pin.currentMode == PIN_MODE_PULSE) return false;
+    // 0 and full scale are constant levels, anything between needs the LEDC clock running
+    if (pin.currentValue > 0 && pin.currentValue < maxDuty(pin)) return false;
+  }
+  return true;
+}
+
+void AvantPinSet::holdOutputs(bool hold) const {
+  TaskLock lock(this);
+  for (size_t i = 0; i < _pinCount; i++) {
+    if (!isVirtual(_pins[i])) AvantPinSetHal::holdPin((uint8_t)_pins[i].pinNumber, hold);
+  }
+}
+
+void IRAM_ATTR AvantPinSet::onHardwareFadeDone(void* arg) {
+  static_cast<PinData*>(arg)->hwFadeDone = true;
+}
+
+bool AvantPinSet::advancePulse(PinData& pin) {
+  // Write the edge that is due, then work out when the next one is
+  pin.pulseOutput = (pin.pulseOutput == HIGH) ? LOW : HIGH;
+  writePulseOutput(pin);
+  if (--pin.pulseEdges == 0) return false;
+
+  // Edges are planned from the start of the train, so late edges do not push back later ones
+  pin.pulseEdgeTime += (pin.pulseOutput == pin.pulseLevel) ? pin.pulseOnUs : pin.pulseOffUs;
+  return true;
+}
+
+void AvantPinSet::writePulseOutput(const PinData& pin) {
+  if (isVirtual(pin)) {
+    writeDigital(pin, pin.pulseOutput);
+    return;
+  }
+
+  uint64_t bit = 1ULL << pin.pinNumber;
+  if (pin.pulseOutput == HIGH) {
+    writeDigitalMasks(bit, 0);
+  } else {
+    writeDigitalMasks(0, bit);
+  }
+}
+
+void AvantPinSet::stopPulse(PinData& pin) {
+  if (pin.currentMode != PIN_MODE_PULSE) return;
+
+#if AVANT_PINSET_HAS_ESP_TIMER
+  // Under the lock, so an edge callback that is already waiting sees the pulse as stopped
+  portENTER_CRITICAL(&pulseLock);
+  pin.pulseEdges = 0;
+  if (pin.pulseTimed) esp_timer_stop(pin.pulseTimer);
+  portEXIT_CRITICAL(&pulseLock);
+#else
+  pin.pulseEdges = 0;
+#endif
+
+  // The pin stays at the level of the last edge until the caller drives it
+  pin.pulseTimed = false;
+  pin.currentMode = PIN_MODE_DIGITAL;
+  pin.currentValue = pin.pulseOutput;
+}
+
+void AvantPinSet::onPulseEdge(void* arg) {
+#if AVANT_PINSET_HAS_ESP_TIMER
+  // Runs on the esp_timer task, which preempts loop() and the scheduler task
+  PinData& pin = *static_cast<PinData*>(arg);
+
+  portENTER_CRITICAL(&pulseLock);
+  // A callback dispatched for a pulse that has since been stopped or restarted comes too early
+  uint64_t now = (uint64_t)esp_timer_get_time();
+  if (pin.pulseEdges > 0 && now >= pin.pulseEdgeTime) {
+    if (advancePulse(pin)) {
+      esp_timer_start_once(pin.pulseTimer, pin.pulseEdgeTime - min(now, pin.pulseEdgeTime));
+    } else {
+      pin.pulseDone = true;
+    }
+  }
+  portEXIT_CRITICAL(&pulseLock);
+#else
+  (void)arg;
+#endif
+}
+
+bool AvantPinSet::setHardwareFade(bool enabled) {
+  TaskLock lock(this);
+#if AVANT_PINSET_HAS_LEDC_FADE
+  _hardwareFade = enabled;
+  return true;
+#else
+  _hardwareFade = false;
+  return !enabled;
+#endif
+}
+
+void AvantPinSet::fireCallback(PinData& pin) {
+  // Called once for every action that completes, whether or not it has a callback
+  _stats.actionsFired++;
+  if (!pin.callback) return;
+  _stats.callbacksRun++;
+
+  // Clear the callback before running it, so the callback itself may start a new timed action
+  PinCallback callback = std::move(pin.callback);
+  pin.callback = nullptr;
+  callback(pin.pinNumber);
+}
+
+void AvantPinSet::scheduleTimer(uint8_t index, uint64_t deadline) {
+  if (_timerSlot[index] < 0) {
+    _timerSlot[index] = (int8_t)_timerCount;
+    _timerHeap[_timerCount++].index = index;
+  }
+  _timerHeap[_timerSlot[index]].deadline = deadline;
+
+  // The deadline may have moved either way, restore the heap order
+  siftUp(_timerSlot[index]);
+  siftDown(_timerSlot[index]);
+
+#if AVANT_PINSET_HAS_FREERTOS
+  // A new earliest deadline means the scheduler task has to wake up sooner
+  if (_taskHandle && _timerSlot[index] == 0 && xTaskGetCurrentTaskHandle() != _taskHandle) {
+    xTaskNotifyGive(_taskHandle);
+  }
+#endif
+}
+
+void AvantPinSet::cancelTimer(uint8_t index) {
+  int slot = _timerSlot[index];
+  if (slot < 0) return;
+
+  _timerSlot[index] = -1;
+  PinTimer last = _timerHeap[--_timerCount];
+
+  // Move the last entry into the freed slot and restore the heap order
+  if (slot < (int)_timerCount) {
+    _timerHeap[slot] = last;
+    _timerSlot[last.index] = (int8_t)slot;
+    siftUp(slot);
+    siftDown(_timerSlot[last.index]);
+  }
+}
+
+bool AvantPinSet::timerBefore(int slotA, int slotB) const {
+  // 64-bit microsecond deadlines do not wrap, so a plain comparison is enough
+  return _timerHeap[slotA].deadline < _timerHeap[slotB].deadline;
+}
+
+void AvantPinSet::swapTimers(int slotA, int slotB) {
+  PinTimer a = _timerHeap[slotA];
+  _timerHeap[slotA] = _timerHeap[slotB];
+  _timerHeap[slotB] = a;
+  _timerSlot[_timerHeap[slotA].index] = (int8_t)slotA;
+  _timerSlot[a.index] = (int8_t)slotB;
+}
+
+void AvantPinSet::siftUp(int slot) {
+  while (slot > 0) {
+    int parent = (slot - 1) / 2;
+    if (!timerBefore(slot, parent)) break;
+    swapTimers(slot, parent);
+    slot = parent;
+  }
+}
+
+void AvantPinSet::siftDown(int slot) {
+  int count = (int)_timerCount;
+  while (true) {
+    int child = 2 * slot + 1;
+    if (child >= count) break;
+    if (child + 1 < count && timerBefore(child + 1, child)) child++;
+    if (!timerBefore(child, slot)) break;
+    swapTimers(slot, child);
+    slot = child;
+  }
+}
+
+// --- Private Helpers ---
+PinData* AvantPinSet::handleData(PinHandle handle) {
+  if (handle.index < 0 || handle.index >= (int)_pinCount) {
+    return nullptr; // Pin not found
+  }
+  return &_pins[handle.index];
+}
+
+PinHandle AvantPinSet::getHandle(int pinNum) const {
+  PinHandle handle;
+  int slot = pinSlot(pinNum);
+  handle.index = (slot >= 0) ? _pinIndex[slot] : -1;
+  return handle;
+}
+
+const char* AvantPinSet::modeName(const PinData& pin) {
+  // Fades and holds of a sequence all report as the sequence
+  if (pin.sequence) return "sequence";
+
+  switch (pin.currentMode) {
+    case PIN_MODE_PWM:
+      return "pwm";
+    case PIN_MODE_HOLD:
+    case PIN_MODE_FADING:
+      return "fading";
+    case PIN_MODE_PULSE:
+      return "pulse";
+    default:
+      return "digital";
+  }
+}
+
+// --- Core Digital Methods ---
+void AvantPinSet::digitalSet(int pinNum, int state) {
+  digitalSet(getHandle(pinNum), state);
+}
+
+void AvantPinSet::digitalSet(PinHandle handle, int state) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  if (!pin) return;
+
+  claimDigital(handle.index, state);
+  writeDigital(*pin, pin->currentValue);
+}
+
+void AvantPinSet::claimDigital(uint8_t index, int state) {
+  PinData& pin = _pins[index];
+
+  // Cancel any ongoing timed action for this pin
+  stopAction(pin);
+  cancelTimer(index);
+  pin.callback = nullptr;
+
+  // If switching from PWM mode to digital mode, reconfigure the pin
+  if (pin.currentMode != PIN_MODE_DIGITAL) {
+    setDigitalOutput(pin);
+  }
+
+  pin.currentMode = PIN_MODE_DIGITAL;
+  pin.currentValue = (state == HIGH) ? HIGH : LOW;
+  markDirty(index);
+}
+
+void AvantPinSet::digitalSetTime(int pinNum, int state, unsigned long delaySeconds, PinCallback callback) {
+  digitalSetTimeUs(getHandle(pinNum), state, delaySeconds * 1000000ULL, callback);
+}
+
+void AvantPinSet::digitalSetTime(PinHandle handle, int state, unsigned long delaySeconds, PinCallback callback) {
+  digitalSetTimeUs(handle, state, delaySeconds * 1000000ULL, callback);
+}
+
+void AvantPinSet::digitalSetTimeMs(int pinNum, int state, unsigned long delayMs, PinCallback callback) {
+  digitalSetTimeUs(getHandle(pinNum), state, delayMs * 1000ULL, callback);
+}
+
+void AvantPinSet::digitalSetTimeMs(PinHandle handle, int state, unsigned long delayMs, PinCallback callback) {
+  digitalSetTimeUs(handle, state, delayMs * 1000ULL, callback);
+}
+
+void AvantPinSet::digitalSetTimeUs(int pinNum, int state, uint64_t delayUs, PinCallback callback) {
+  digitalSetTimeUs(getHandle(pinNum), state, delayUs, callback);
+}
+
+void AvantPinSet::digitalSetTimeUs(PinHandle handle, int state, uint64_t delayUs, PinCallback callback) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  if (!pin) return;
+
+  stopAction(*pin);
+
+  // If switching from PWM mode to digital mode, reconfigure the pin
+  if (pin->currentMode != PIN_MODE_DIGITAL) {
+    setDigitalOutput(*pin);
+  }
+
+  // 1. Set the pin to the target state immediately
+  pin->currentMode = PIN_MODE_DIGITAL;
+  pin->currentValue = (state == HIGH) ? HIGH : LOW;
+  writeDigital(*pin, pin->currentValue);
+  markDirty(handle.index);
+
+  // 2. Configure the timer to revert to the opposite state after the delay
+  pin->startTime = clockMicros();
+  pin->duration = delayUs;
+  pin->targetValue = (state == HIGH) ? LOW : HIGH;  // Revert to opposite state
+  pin->callback = callback;
+  scheduleTimer(handle.index, pin->startTime + pin->duration);
+}
+
+
+// --- Pulse Methods ---
+bool AvantPinSet::pulse(int pinNum, uint32_t widthUs, PinCallback callback) {
+  return pulseTrain(getHandle(pinNum), widthUs, 0, 1, callback);
+}
+
+bool AvantPinSet::pulse(PinHandle handle, uint32_t widthUs, PinCallback callback) {
+  return pulseTrain(handle, widthUs, 0, 1, callback);
+}
+
+bool AvantPinSet::pulseTrain(int pinNum, uint32_t onUs, uint32_t offUs, uint16_t count, PinCallback callback) {
+  return pulseTrain(getHandle(pinNum), onUs, offUs, count, callback);
+}
+
+bool AvantPinSet::pulseTrain(PinHandle handle, uint32_t onUs, uint32_t offUs, uint16_t count, PinCallback callback) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  if (!pin || onUs == 0 || count == 0) return false;
+
+  stopAction(*pin);
+
+  // The pulse drives the pin away from its idle level; a PWM pin idles LOW
+  if (!isDigitalMode(pin->currentMode)) {
+    setDigitalOutput(*pin);
+    pin->currentValue = LOW;
+    writeDigital(*pin, LOW);
+  }
+
+  pin->currentMode = PIN_MODE_PULSE;
+  pin->pulseLevel = (pin->currentValue == HIGH) ? LOW : HIGH;
+  pin->pulseOutput = (uint8_t)pin->currentValue;
+  pin->pulseOnUs = onUs;
+  pin->pulseOffUs = offUs;
+  pin->pulseDone = false;
+  pin->pulseTimed = false;
+  pin->callback = callback;
+  pin->duration = (uint64_t)count * onUs + (uint64_t)(count - 1) * offUs;
+  markDirty(handle.index);
+
+#if AVANT_PINSET_HAS_ESP_TIMER
+  if (!pin->pulseTimer) {
+    esp_timer_create_args_t args = {};
+    args.callback = onPulseEdge;
+    args.arg = pin;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "AvantPinSet";
+    if (esp_timer_create(&args, &pin->pulseTimer) != ESP_OK) pin->pulseTimer = nullptr;
+  }
+
+  // Write the leading edge under the lock, so the timer is measured from it
+  portENTER_CRITICAL(&pulseLock);
+  pin->pulseEdges = 2UL * count; // The leading edge, then one edge per phase
+  advancePulse(*pin);
+  pin->startTime = clockMicros();
+  pin->pulseEdgeTime = pin->startTime + onUs;
+  pin->pulseTimed = pin->pulseTimer && !isVirtual(*pin) && esp_timer_start_once(pin->pulseTimer, onUs) == ESP_OK;
+  portEXIT_CRITICAL(&pulseLock);
+#else
+  pin->pulseEdges = 2UL * count;
+  advancePulse(*pin);
+  pin->startTime = clockMicros();
+  pin->pulseEdgeTime = pin->startTime + onUs;
+#endif
+
+  // With a hardware timer, check back when the train should be over; otherwise at the next edge.
+  // If the timer could not be started, update() writes the edges, at its own accuracy.
+  scheduleTimer(handle.index, pin->pulseTimed ? pin->startTime + pin->duration : pin->pulseEdgeTime);
+  return true;
+}
+
+
+// --- Batch Methods ---
+void AvantPinSet::digitalSetMask(uint64_t mask, uint64_t values) {
+  TaskLock lock(this);
+  uint64_t setMask = 0;
+  uint64_t clearMask = 0;
+
+  for (uint8_t gpio = 0; mask != 0 && gpio < AVANT_PINSET_MAX_GPIO; gpio++, mask >>= 1) {
+    if (!(mask & 1)) continue;
+
+    int index = _pinIndex[gpio];
+    if (index < 0) continue; // Not managed by this instance
+
+    int state = ((values >> gpio) & 1) ? HIGH : LOW;
+    claimDigital(index, state);
+    if (state == HIGH) {
+      setMask |= 1ULL << gpio;
+    } else {
+      clearMask |= 1ULL << gpio;
+    }
+  }
+
+  writeDigitalMasks(setMask, clearMask);
+}
+
+void AvantPinSet::applyBatch(const PinCommand* commands, size_t count) {
+  TaskLock lock(this);
+  uint64_t setMask = 0;
+  uint64_t clearMask = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    const PinCommand& command = commands[i];
+    PinHandle handle = getHandle(command.pinNumber);
+    if (!handle.isValid()) continue;
+
+    if (isVirtual(_pins[handle.index])) {
+      // Driver writes are collected until the end of the batch anyway
+      applyCommand(command);
+      continue;
+    }
+
+    uint64_t bit = 1ULL << command.pinNumber;
+    if (command.type == PIN_CMD_DIGITAL_SET) {
+      // Defer the write so all digital outputs of the batch switch together
+      claimDigital(handle.index, command.value);
+      if (_pins[handle.index].currentValue == HIGH) {
+        setMask |= bit;
+        clearMask &= ~bit;
+      } else {
+        clearMask |= bit;
+        setMask &= ~bit;
+      }
+    } else {
+      // A later command on a pin with a deferred write must see that write happen first
+      if ((setMask | clearMask) & bit) {
+        writeDigitalMasks(setMask, clearMask);
+        setMask = 0;
+        clearMask = 0;
+      }
+      applyCommand(command);
+    }
+  }
+
+  writeDigitalMasks(setMask, clearMask);
+}
+
+// --- Binary Protocol ---
+size_t AvantPinSet::frameLength(uint8_t opcode) {
+  switch (opcode) {
+    case PIN_CMD_DIGITAL_SET:
+    case PIN_CMD_PWM_SET:
+      return 4;
+    case PIN_CMD_DIGITAL_SET_TIME:
+    case PIN_CMD_PWM_SET_TIME:
+      return 8;
+    case PIN_CMD_PWM_FADE:
+      return 6;
+    case PIN_CMD_PWM_FADE_TIME:
+      return 10;
+    default:
+      return 0;
+  }
+}
+
+size_t AvantPinSet::applyFrames(const uint8_t* data, size_t length) {
+  TaskLock lock(this);
+  PinCommand batch[AVANT_PINSET_QUEUE_SIZE];
+  size_t count = 0;
+  size_t offset = 0;
+
+  while (offset < length) {
+    const uint8_t* frame = data + offset;
+    size_t frameSize = frameLength(frame[0]);
+    if (frameSize == 0 || offset + frameSize > length) break; // Unknown opcode, or cut off
+
+    PinCommand& command = batch[count++];
+    command.type = (PinCommandType)frame[0];
+    command.pinNumber = frame[1];
+    command.value = readLe16(frame + 2);
+    command.value2 = 0;
+    command.time = 0;
+
+    // The fade finish value comes before the time, so the two timed layouts differ
+    if (command.type == PIN_CMD_PWM_FADE || command.type == PIN_CMD_PWM_FADE_TIME) command.value2 = readLe16(frame + 4);
+    if (frameSize == 8) command.time = readLe32(frame + 4);
+    if (frameSize == 10) command.time = readLe32(frame + 6);
+    offset += frameSize;
+
+    // Long packets are applied in chunks, so the batch stays on the stack
+    if (count == AVANT_PINSET_QUEUE_SIZE) {
+      applyBatch(batch, count);
+      count = 0;
+    }
+  }
+
+  if (count > 0) applyBatch(batch, count);
+  return offset;
+}
+
+size_t AvantPinSet::encodeFrame(const PinCommand& command, uint8_t* buffer, size_t bufferSize) {
+  size_t frameSize = frameLength(command.type);
+  if (frameSize == 0 || !buffer || frameSize > bufferSize) return 0;
+
+  buffer[0] = command.type;
+  buffer[1] = command.pinNumber;
+  writeLe16(buffer + 2, command.value);
+  if (command.type == PIN_CMD_PWM_FADE || command.type == PIN_CMD_PWM_FADE_TIME) writeLe16(buffer + 4, command.value2);
+  if (frameSize == 8) writeLe32(buffer + 4, command.time);
+  if (frameSize == 10) writeLe32(buffer + 6, command.time);
+  return frameSize;
+}
+
+void AvantPinSet::writeDigitalMasks(uint64_t setMask, uint64_t clearMask) {
+#if defined(ARDUINO_ARCH_ESP32)
+  // One store per register bank switches every pin in the bank in the same cycle
+  if ((uint32_t)setMask) REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)setMask);
+  if ((uint32_t)clearMask) REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)clearMask);
+#ifdef GPIO_OUT1_W1TS_REG
+  if (setMask >> 32) REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)(setMask >> 32));
+  if (clearMask >> 32) REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)(clearMask >> 32));
+#endif
+#else
+  // No set/clear registers on this platform, fall back to one write per pin
+  for (uint8_t gpio = 0; (setMask | clearMask) != 0; gpio++, setMask >>= 1, clearMask >>= 1) {
+    if (setMask & 1) AvantPinSetHal::digitalWrite(gpio, HIGH);
+    if (clearMask & 1) AvantPinSetHal::digitalWrite(gpio, LOW);
+  }
+#endif
+}
+
+
+// --- Core PWM Methods ---
+void AvantPinSet::pwmSet(int pinNum, int pwmValue) {
+  pwmSet(getHandle(pinNum), pwmValue);
+}
+
+void AvantPinSet::pwmSet(PinHandle handle, int pwmValue) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  if (!pin) return;
+
+  // Constrain PWM value to be safe
+  pwmValue = constrain(pwmValue, 0, maxDuty(*pin));
+
+  // Cancel any ongoing timed action
+  stopAction(*pin);
+  cancelTimer(handle.index);
+  pin->callback = nullptr;
+
+  pin->currentMode = PIN_MODE_PWM;
+  pin->currentValue = pwmValue;
+  writePwm(*pin, pin->currentValue);
+  markDirty(handle.index);
+}
+
+bool AvantPinSet::pwmAttach(int pinNum, uint32_t frequency, uint8_t resolutionBits) {
+  return pwmAttach(getHandle(pinNum), frequency, resolutionBits);
+}
+
+bool AvantPinSet::pwmAttach(PinHandle handle, uint32_t frequency, uint8_t resolutionBits) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  if (!pin || frequency == 0) return false;
+
+  // Values of a virtual pin are scaled to its device's resolution, and the frequency is set on the device
+  bool virtualPin = isVirtual(*pin);
+  if (virtualPin ? (resolutionBits < 1 || resolutionBits > AVANT_PINSET_MAX_PWM_RESOLUTION)
+                 : validResolution(resolutionBits) != resolutionBits) {
+    return false;
+  }
+
+  pin->pwmFrequency = frequency;
+  pin->pwmResolution = resolutionBits;
+
+#if !AVANT_PINSET_HAS_LEDC_CHANNEL
+  // Other GPIOs stay at analogWrite()'s 8 bits, so there is nothing to rescale
+  if (!virtualPin) return true;
+#endif
+
+  // Release the old channel; it is attached again with the new settings by the next PWM write
+  stopAction(*pin);
+#if AVANT_PINSET_HAS_LEDC_CHANNEL
+  if (!virtualPin && pin->ledcChannel != LEDC_DETACHED) {
+    ledcDetach(pin->pinNumber);
+    pin->ledcChannel = LEDC_DETACHED;
+  }
+#endif
+
+  // A running PWM action is cancelled and the pin keeps its value, clamped to the new range
+  if (pin->currentMode != PIN_MODE_DIGITAL) {
+    cancelTimer(handle.index);
+    pin->callback = nullptr;
+    pin->currentMode = PIN_MODE_PWM;
+    pin->currentValue = min(pin->currentValue, maxDuty(*pin));
+    writePwm(*pin, pin->currentValue);
+    markDirty(handle.index);
+    return virtualPin ? pin->driver != nullptr : pin->ledcChannel >= 0;
+  }
+  return true;
+}
+
+int AvantPinSet::pwmMaxValue(int pinNum) const {
+  return pwmMaxValue(getHandle(pinNum));
+}
+
+int AvantPinSet::pwmMaxValue(PinHandle handle) const {
+  TaskLock lock(this);
+  if (handle.index < 0 || handle.index >= (int)_pinCount) return 0;
+  return maxDuty(_pins[handle.index]);
+}
+
+uint8_t AvantPinSet::validResolution(uint8_t resolutionBits) {
+#if AVANT_PINSET_HAS_LEDC_CHANNEL
+#ifdef SOC_LEDC_TIMER_BIT_WIDTH
+  if (resolutionBits > SOC_LEDC_TIMER_BIT_WIDTH) return AVANT_PINSET_PWM_RESOLUTION;
+#endif
+  if (resolutionBits >= 1 && resolutionBits <= AVANT_PINSET_MAX_PWM_RESOLUTION) return resolutionBits;
+#else
+  (void)resolutionBits;
+#endif
+  // analogWrite() is fixed at 8 bits
+  return 8;
+}
+
+void AvantPinSet::writePwm(PinData& pin, int value) {
+  if (isVirtual(pin)) {
+    if (!pin.driver) return;
+
+    // Scale from the pin's resolution to the device's
+    uint32_t deviceMax = (1UL << pin.driver->resolution()) - 1;
+    uint32_t pinMax = (uint32_t)maxDuty(pin);
+    uint32_t duty = (uint32_t)constrain(value, 0, maxDuty(pin));
+    if (pinMax != deviceMax) duty = (duty * deviceMax + pinMax / 2) / pinMax;
+    pin.driver->write(pin.driverChannel, (uint16_t)duty);
+    return;
+  }
+
+#if AVANT_PINSET_HAS_LEDC_CHANNEL
+  // Attach right away, so callers and hardware fades can rely on the channel
+  if (pin.ledcChannel == LEDC_DETACHED) attachLedc(pin);
+#endif
+
+  // Inside an operation only the last duty per pin is kept, and written when the operation ends
+  if (_lockDepth > 0) {
+    pin.pendingPwm = value;
+    _pwmPending |= 1ULL << (&pin - _pins);
+    return;
+  }
+  outputPwm(pin, value);
+}
+
+void AvantPinSet::outputPwm(PinData& pin, int value) {
+  // Fade ticks often land on the duty the pin already has, skip those writes
+  if (value == pin.writtenPwm) return;
+  pin.writtenPwm = value;
+
+#if AVANT_PINSET_HAS_LEDC_CHANNEL
+  if (pin.ledcChannel >= 0) {
+    // Like ledcWrite(), full scale is written as 2^resolution so the output never drops low
+    uint32_t duty = (uint32_t)value;
+    if (value >= maxDuty(pin) && pin.pwmResolution > 1) duty = (uint32_t)maxDuty(pin) + 1;
+
+    // The core assigns LEDC channels in groups of 8 per speed mode
+    ledc_mode_t mode = (ledc_mode_t)(pin.ledcChannel / 8);
+    ledc_channel_t channel = (ledc_channel_t)(pin.ledcChannel % 8);
+    ledc_set_duty(mode, channel, duty);
+    ledc_update_duty(mode, channel);
+    return;
+  }
+#endif
+  AvantPinSetHal::analogWrite(pin.pinNumber, value);
+}
+
+void AvantPinSet::writePendingPwm() {
+  while (_pwmPending) {
+    uint8_t index = (uint8_t)__builtin_ctzll(_pwmPending);
+    _pwmPending &= _pwmPending - 1;
+    outputPwm(_pins[index], _pins[index].pendingPwm);
+  }
+}
+
+void AvantPinSet::forgetPwm(PinData& pin) {
+  // Something else changed or owns the duty, so the next write has to go out
+  _pwmPending &= ~(1ULL << (&pin - _pins));
+  pin.writtenPwm = -1;
+}
+
+void AvantPinSet::attachLedc(PinData& pin) {
+  forgetPwm(pin);
+#if AVANT_PINSET_HAS_LEDC_CHANNEL
+  // Look the channel up once; if attaching fails the pin falls back to analogWrite()
+  pin.ledcChannel = LEDC_UNAVAILABLE;
+  if (!ledcAttach(pin.pinNumber, pin.pwmFrequency, pin.pwmResolution)) return;
+
+  ledc_channel_handle_t* bus = (ledc_channel_handle_t*)perimanGetPinBus(pin.pinNumber, ESP32_BUS_TYPE_LEDC);
+  if (bus) pin.ledcChannel = (int8_t)bus->channel;
+#else
+  (void)pin;
+#endif
+}
+
+void AvantPinSet::setDigitalOutput(PinData& pin) {
+  if (isVirtual(pin)) {
+    if (pin.driver) pin.driver->setOutput(pin.driverChannel);
+    return;
+  }
+
+  // On the 3.x core this also releases the pin's LEDC channel
+  forgetPwm(pin);
+  AvantPinSetHal::pinMode(pin.pinNumber, OUTPUT);
+  pin.ledcChannel = LEDC_DETACHED;
+}
+
+// --- Output Drivers ---
+bool AvantPinSet::attachDriver(PinOutputDriver& driver, int firstPin) {
+  TaskLock lock(this);
+  int lastPin = firstPin + driver.channelCount() - 1;
+  if (_driverCount >= AVANT_PINSET_MAX_DRIVERS || driver.channelCount() == 0) return false;
+  if (firstPin < AVANT_PINSET_VIRTUAL_PIN_BASE || lastPin >= AVANT_PINSET_VIRTUAL_PIN_BASE + AVANT_PINSET_MAX_VIRTUAL_PINS) return false;
+  for (uint8_t i = 0; i < _driverCount; i++) {
+    int otherLast = _driverFirstPin[i] + _drivers[i]->channelCount() - 1;
+    if (firstPin <= otherLast && lastPin >= _driverFirstPin[i]) return false;
+  }
+  if (!driver.begin()) return false;
+
+  _drivers[_driverCount] = &driver;
+  _driverFirstPin[_driverCount] = (uint8_t)firstPin;
+  _driverCount++;
+
+  // Bring the device's outputs to the state the pins already have, flushed when the lock is released
+  for (int pinNum = firstPin; pinNum <= lastPin; pinNum++) {
+    PinHandle handle = getHandle(pinNum);
+    PinData* pin = handleData(handle);
+    if (!pin) continue;
+
+    pin->driver = &driver;
+    pin->driverChannel = (uint8_t)(pinNum - firstPin);
+    setDigitalOutput(*pin);
+    if (isDigitalMode(pin->currentMode)) {
+      writeDigital(*pin, pin->currentValue);
+    } else {
+      writePwm(*pin, pin->currentValue);
+    }
+  }
+  return true;
+}
+
+int AvantPinSet::pinSlot(int pinNum) {
+  if (pinNum >= 0 && pinNum < AVANT_PINSET_MAX_GPIO) return pinNum;
+  if (pinNum >= AVANT_PINSET_VIRTUAL_PIN_BASE && pinNum < AVANT_PINSET_VIRTUAL_PIN_BASE + AVANT_PINSET_MAX_VIRTUAL_PINS) {
+    return AVANT_PINSET_MAX_GPIO + pinNum - AVANT_PINSET_VIRTUAL_PIN_BASE;
+  }
+  return -1;
+}
+
+void AvantPinSet::writeDigital(const PinData& pin, int level) {
+  if (!isVirtual(pin)) {
+    AvantPinSetHal::digitalWrite(pin.pinNumber, level);
+  } else if (pin.driver) {
+    pin.driver->write(pin.driverChannel, level == HIGH ? (uint16_t)((1UL << pin.driver->resolution()) - 1) : 0);
+  }
+}
+
+void AvantPinSet::flushDrivers() const {
+  for (uint8_t i = 0; i < _driverCount; i++) _drivers[i]->flush();
+}
+
+void AvantPinSet::pwmSetTime(int pinNum, int pwmValue, unsigned long delaySeconds, PinCallback callback) {
+  pwmSetTimeUs(getHandle(pinNum), pwmValue, delaySeconds * 1000000ULL, callback);
+}
+
+void AvantPinSet::pwmSetTime(PinHandle handle, int pwmValue, unsigned long delaySeconds, PinCallback callback) {
+  pwmSetTimeUs(handle, pwmValue, delaySeconds * 1000000ULL, callback);
+}
+
+void AvantPinSet::pwmSetTimeMs(int pinNum, int pwmValue, unsigned long delayMs, PinCallback callback) {
+  pwmSetTimeUs(getHandle(pinNum), pwmValue, delayMs * 1000ULL, callback);
+}
+
+void AvantPinSet::pwmSetTimeMs(PinHandle handle, int pwmValue, unsigned long delayMs, PinCallback callback) {
+  pwmSetTimeUs(handle, pwmValue, delayMs * 1000ULL, callback);
+}
+
+void AvantPinSet::pwmSetTimeUs(int pinNum, int pwmValue, uint64_t delayUs, PinCallback callback) {
+  pwmSetTimeUs(getHandle(pinNum), pwmValue, delayUs, callback);
+}
+
+void AvantPinSet::pwmSetTimeUs(PinHandle handle, int pwmValue, uint64_t delayUs, PinCallback callback) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  if (!pin) return;
+
+  pwmValue = constrain(pwmValue, 0, maxDuty(*pin));
+  stopAction(*pin);
+
+  // 1. Set PWM value immediately
+  pin->currentMode = PIN_MODE_PWM;
+  pin->currentValue = pwmValue;
+  writePwm(*pin, pin->currentValue);
+  markDirty(handle.index);
+
+  // 2. Schedule revert to opposite state after the delay
+  pin->startTime = clockMicros();
+  pin->duration = delayUs;
+  pin->targetValue = (pin->currentValue == 0) ? maxDuty(*pin) : 0; // Revert logic (adjust as needed)
+  pin->callback = callback;
+  scheduleTimer(handle.index, pin->startTime + pin->duration);
+}
+
+void AvantPinSet::pwmFade(int pinNum, int beginPwmValue, int finishPwmValue) {
+  pwmFade(getHandle(pinNum), beginPwmValue, finishPwmValue, DEFAULT_FADE_MS);
+}
+
+void AvantPinSet::pwmFade(PinHandle handle, int beginPwmValue, int finishPwmValue) {
+  pwmFade(handle, beginPwmValue, finishPwmValue, DEFAULT_FADE_MS);
+}
+
+void AvantPinSet::pwmFade(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long fadeDurationMs, FadeCurve curve) {
+  pwmFade(getHandle(pinNum), beginPwmValue, finishPwmValue, fadeDurationMs, curve);
+}
+
+void AvantPinSet::pwmFade(PinHandle handle, int beginPwmValue, int finishPwmValue, unsigned long fadeDurationMs, FadeCurve curve) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  if (!pin) return;
+
+  beginPwmValue = constrain(beginPwmValue, 0, maxDuty(*pin));
+  finishPwmValue = constrain(finishPwmValue, 0, maxDuty(*pin));
+  stopAction(*pin);
+
+  pin->startTime = clockMicros();
+  pin->duration = fadeDurationMs * 1000ULL;
+  pin->fadeDuration = pin->duration;
+  pin->fadeCurve = curve;
+  pin->startPwmValue = beginPwmValue;
+  pin->finishPwmValue = finishPwmValue;
+  pin->currentValue = beginPwmValue; // Set current value to start value
+  markDirty(handle.index);
+
+  // Set the initial PWM value immediately, then start fading
+  writePwm(*pin, pin->startPwmValue);
+  beginFade(handle.index, pin->startTime);
+}
+
+void AvantPinSet::pwmFadeTime(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds, PinCallback callback) {
+  pwmFadeTimeUs(getHandle(pinNum), beginPwmValue, finishPwmValue, holdTimeSeconds * 1000000ULL, DEFAULT_FADE_MS * 1000ULL, FADE_LINEAR, callback);
+}
+
+void AvantPinSet::pwmFadeTime(PinHandle handle, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds, PinCallback callback) {
+  pwmFadeTimeUs(handle, beginPwmValue, finishPwmValue, holdTimeSeconds * 1000000ULL, DEFAULT_FADE_MS * 1000ULL, FADE_LINEAR, callback);
+}
+
+void AvantPinSet::pwmFadeTime(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds,
+                              unsigned long fadeDurationMs, FadeCurve curve, PinCallback callback) {
+  pwmFadeTimeUs(getHandle(pinNum), beginPwmValue, finishPwmValue, holdTimeSeconds * 1000000ULL, fadeDurationMs * 1000ULL, curve, callback);
+}
+
+void AvantPinSet::pwmFadeTime(PinHandle handle, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds,
+                              unsigned long fadeDurationMs, FadeCurve curve, PinCallback callback) {
+  pwmFadeTimeUs(handle, beginPwmValue, finishPwmValue, holdTimeSeconds * 1000000ULL, fadeDurationMs * 1000ULL, curve, callback);
+}
+
+void AvantPinSet::pwmFadeTimeMs(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long holdMs,
+                                unsigned long fadeDurationMs, FadeCurve curve, PinCallback callback) {
+  pwmFadeTimeUs(getHandle(pinNum), beginPwmValue, finishPwmValue, holdMs * 1000ULL, fadeDurationMs * 1000ULL, curve, callback);
+}
+
+void AvantPinSet::pwmFadeTimeMs(PinHandle handle, int beginPwmValue, int finishPwmValue, unsigned long holdMs,
+                                unsigned long fadeDurationMs, FadeCurve curve, PinCallback callback) {
+  pwmFadeTimeUs(handle, beginPwmValue, finishPwmValue, holdMs * 1000ULL, fadeDurationMs * 1000ULL, curve, callback);
+}
+
+void AvantPinSet::pwmFadeTimeUs(int pinNum, int beginPwmValue, int finishPwmValue, uint64_t holdUs,
+                                uint64_t fadeDurationUs, FadeCurve curve, PinCallback callback) {
+  pwmFadeTimeUs(getHandle(pinNum), beginPwmValue, finishPwmValue, holdUs, fadeDurationUs, curve, callback);
+}
+
+void AvantPinSet::pwmFadeTimeUs(PinHandle handle, int beginPwmValue, int finishPwmValue, uint64_t holdUs,
+                                uint64_t fadeDurationUs, FadeCurve curve, PinCallback callback) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  if (!pin) return;
+
+  beginPwmValue = constrain(beginPwmValue, 0, maxDuty(*pin));
+  finishPwmValue = constrain(finishPwmValue, 0, maxDuty(*pin));
+  stopAction(*pin);
+
+  pin->currentMode = PIN_MODE_HOLD;   // We're holding before fading
+  pin->startTime = clockMicros();
+  pin->duration = holdUs;               // This is now the holding time
+  pin->fadeDuration = fadeDurationUs;   // Used once the holding time is over
+  pin->fadeCurve = curve;
+  pin->startPwmValue = beginPwmValue;
+  pin->finishPwmValue = finishPwmValue;
+  pin->currentValue = beginPwmValue; // Set current value to start value
+  markDirty(handle.index);
+  pin->fadeStartTime = 0;            // Will be set when fade starts
+  pin->callback = callback;
+
+  // Set the initial PWM value immediately, it is held until the timer expires
+  writePwm(*pin, pin->startPwmValue);
+  scheduleTimer(handle.index, pin->startTime + pin->duration);
+}
+
+void AvantPinSet::pwmSequence(int pinNum, const PinKeyframe* keyframes, uint8_t keyframeCount, uint16_t repeatCount,
+                              PinCallback callback) {
+  pwmSequence(getHandle(pinNum), keyframes, keyframeCount, repeatCount, callback);
+}
+
+void AvantPinSet::pwmSequence(PinHandle handle, const PinKeyframe* keyframes, uint8_t keyframeCount, uint16_t repeatCount,
+                              PinCallback callback) {
+  TaskLock lock(this);
+  PinData* pin = handleData(handle);
+  if (!pin || !keyframes || keyframeCount == 0) return;
+
+  stopAction(*pin);
+
+  // A digital pin is switched to PWM at 0, so the first fade starts from off
+  if (isDigitalMode(pin->currentMode)) {
+    pin->currentMode = PIN_MODE_PWM;
+    pin->currentValue = 0;
+    writePwm(*pin, 0);
+  }
+
+  pin->sequence = keyframes;
+  pin->sequenceLength = keyframeCount;
+  pin->sequenceStep = 0;
+  pin->sequenceRepeat = repeatCount;
+  pin->callback = callback;
+  markDirty(handle.index);
+  runSequenceStep(handle.index, clockMicros());
+}
+
+// --- Pin Groups ---
+int AvantPinSet::addGroup(const char* name, const int pinList[], uint8_t count) {
+  TaskLock lock(this);
+  if (!name || !pinList || count == 0 || count > AVANT_PINSET_GROUP_SIZE) return -1;
+  if (_groupCount >= AVANT_PINSET_MAX_GROUPS || groupId(name) >= 0) return -1;
+
+  PinGroup& group = _groups[_groupCount];
+  for (uint8_t i = 0; i < count; i++) {
+    PinHandle handle = getHandle(pinList[i]);
+    if (!handle.isValid()) return -1;
+    // A pin listed twice would leave the fade it is joining, dropping the members set up before it
+    for (uint8_t j = 0; j < i; j++) {
+      if (group.members[j] == handle.index) return -1;
+    }
+    group.members[i] = (uint8_t)handle.index;
+  }
+  strncpy(group.name, name, sizeof(group.name) - 1);
+  group.name[sizeof(group.name) - 1] = '\0';
+  group.count = count;
+  return _groupCount++;
+}
+
+int AvantPinSet::groupId(const char* name) const {
+  TaskLock lock(this);
+  if (!name) return -1;
+  for (uint8_t i = 0; i < _groupCount; i++) {
+    if (strncmp(_groups[i].name, name, sizeof(_groups[i].name) - 1) == 0) return i;
+  }
+  return -1;
+}
+
+bool AvantPinSet::groupFade(const char* name, const int fromValues[], const int toValues[], unsigned long durationMs,
+                            PinCallback callback, FadeCurve curve) {
+  return groupFade(groupId(name), fromValues, toValues, durationMs, callback, curve);
+}
+
+bool AvantPinSet::groupFade(int groupId, const int fromValues[], const int toValues[], unsigned long durationMs,
+                            PinCallback callback, FadeCurve curve) {
+  TaskLock lock(this);
+  if (groupId < 0 || groupId >= _groupCount || !toValues) return false;
+
+  const PinGroup& group = _groups[groupId];
+  uint64_t now = clockMicros();
+  uint32_t maxDistance = 0;
+
+  for (uint8_t i = 0; i < group.count; i++) {
+    uint8_t index = group.members[i];
+    PinData& pin = _pins[index];
+
+    // Without start values, fade from where each pin is now; digital pins count as off or full scale
+    int from;
+    if (fromValues) {
+      from = fromValues[i];
+    } else if (isDigitalMode(pin.currentMode)) {
+      from = (pin.currentValue == HIGH) ? maxDuty(pin) : 0;
+    } else {
+      from = (pin.currentMode == PIN_MODE_FADING) ? fadePosition(pin, now) : pin.currentValue;
+    }
+
+    // Ends any earlier fade of the pin, including another group fade it was part of
+    stopAction(pin);
+    if (i > 0) cancelTimer(index); // Only the first member keeps a timer
+
+    pin.startPwmValue = constrain(from, 0, maxDuty(pin));
+    pin.finishPwmValue = constrain(toValues[i], 0, maxDuty(pin));
+    pin.startTime = now;
+    pin.fadeStartTime = now;
+    pin.duration = durationMs * 1000ULL;
+    pin.fadeDuration = pin.duration;
+    pin.fadeCurve = curve;
+    pin.currentValue = pin.startPwmValue;
+    pin.currentMode = PIN_MODE_FADING;
+    pin.fadeGroup = (uint8_t)groupId;
+    pin.callback = nullptr;
+    markDirty(index);
+    writePwm(pin, pin.startPwmValue);
+
+    maxDistance = max(maxDistance, fadeDistance(pin));
+  }
+
+  // The first member carries the shared timer and the single callback
+  uint8_t leader = group.members[0];
+  PinData& pin = _pins[leader];
+  pin.callback = std::move(callback);
+
+  // Tick about once per output step of the member that moves furthest
+  uint64_t steps = (uint64_t)maxDistance * ((curve == FADE_LINEAR) ? 1 : 4);
+  uint64_t tick = (steps > 0) ? pin.duration / steps : pin.duration;
+  pin.fadeTick = (uint32_t)constrain(tick, (uint64_t)AVANT_PINSET_MIN_FADE_TICK_US, (uint64_t)UINT32_MAX);
+  scheduleTimer(leader, min(now + pin.fadeTick, now + pin.duration));
+  return true;
+}
+
+void AvantPinSet::runGroupFade(uint8_t index, uint64_t currentMicros) {
+  AVANT_PINSET_PROFILE(PROFILE_FADE_STEP);
+  PinData& leader = _pins[index];
+  uint8_t groupId = leader.fadeGroup;
+  const PinGroup& group = _groups[groupId];
+
+  // One progress value for the whole group, eased once for rising and once for falling members
+  uint32_t progress = groupProgress(leader, currentMicros);
+  bool done = progress >= 65536UL;
+  uint32_t rising = easeProgress(leader.fadeCurve, progress, false);
+  uint32_t falling = easeProgress(leader.fadeCurve, progress, true);
+
+  for (uint8_t i = 0; i < group.count; i++) {
+    uint8_t member = group.members[i];
+    PinData& pin = _pins[member];
+    if (pin.fadeGroup != groupId) continue; // Taken out of the fade by another call
+
+    if (done) {
+      pin.currentValue = pin.finishPwmValue;
+      writePwm(pin, pin.currentValue);
+      pin.currentMode = PIN_MODE_PWM;
+      pin.fadeGroup = NO_GROUP;
+      markDirty(member);
+    } else {
+      writePwm(pin, groupFadeValue(pin, (pin.finishPwmValue >= pin.startPwmValue) ? rising : falling));
+    }
+  }
+
+  if (done) {
+    cancelTimer(index);
+    completeAction(index, PIN_EVENT_GROUP_FADE);
+  } else {
+    scheduleTimer(index, min(currentMicros + leader.fadeTick, leader.fadeStartTime + leader.duration));
+  }
+}
+
+void AvantPinSet::leaveGroupFade(PinData& pin) {
+  uint8_t groupId = pin.fadeGroup;
+  uint8_t index = (uint8_t)(&pin - _pins);
+  pin.fadeGroup = NO_GROUP;
+
+  // Other members simply drop out; the first one carries the timer, so the rest stop where they are
+  const PinGroup& group = _groups[groupId];
+  if (group.members[0] != index) return;
+
+  uint64_t now = clockMicros();
+  for (uint8_t i = 1; i < group.count; i++) {
+    PinData& member = _pins[group.members[i]];
+    if (member.fadeGroup != groupId) continue;
+    member.currentValue = fadePosition(member, now);
+    member.currentMode = PIN_MODE_PWM;
+    member.fadeGroup = NO_GROUP;
+    markDirty(group.members[i]);
+  }
+}
+
+uint32_t AvantPinSet::groupProgress(const PinData& pin, uint64_t now) {
+  // Fraction of the fade done, 0 to 65536
+  uint64_t elapsed = now - pin.fadeStartTime;
+  if (elapsed >= pin.duration) return 65536UL;
+  return (uint32_t)((elapsed << 16) / pin.duration);
+}
+
+uint32_t AvantPinSet::easeProgress(FadeCurve curve, uint32_t progress, bool falling) {
+  if (curve == FADE_LINEAR || progress >= 65536UL) return progress;
+
+  // Same table interpolation as fadeValue(), including the mirrored brightness curves for falling fades
+  bool mirrored = falling && (curve == FADE_GAMMA || curve == FADE_CIE);
+  if (mirrored) progress = 65536UL - progress;
+
+  const uint16_t* table = curveTable(curve);
+  uint32_t accumulator = progress * 255; // Table position in 16.16 fixed point
+  uint32_t position = accumulator >> 16;
+  uint32_t eased = table[255];
+  if (position < 255) {
+    uint32_t fraction = accumulator & 0xFFFFUL;
+    eased = table[position] + (((uint32_t)(table[position + 1] - table[position]) * fraction) >> 16);
+  }
+  return mirrored ? 65535UL - eased : eased;
+}
+
+int AvantPinSet::groupFadeValue(const PinData& pin, uint32_t eased) {
+  int64_t distance = (int64_t)pin.finishPwmValue - pin.startPwmValue;
+  return pin.startPwmValue + (int)((distance * eased + ((distance >= 0) ? 0x8000 : -0x8000)) / 65536);
+}
+
+// --- Status Methods ---
+String AvantPinSet::systemStatus() {
+  AVANT_PINSET_PROFILE(PROFILE_SYSTEM_STATUS);
+  TaskLock lock(this);
+  return buildStatus(ALL_PINS);
+}
+
+bool AvantPinSet::hasChanges() const {
+  TaskLock lock(this);
+  return _dirtyMask != 0;
+}
+
+String AvantPinSet::statusDelta() {
+  AVANT_PINSET_PROFILE(PROFILE_STATUS_DELTA);
+  TaskLock lock(this);
+  String output = buildStatus(_dirtyMask);
+  _dirtyMask = 0;
+  return output;
+}
+
+size_t AvantPinSet::statusDelta(char* buffer, size_t bufferSize) {
+  AVANT_PINSET_PROFILE(PROFILE_STATUS_DELTA);
+  TaskLock lock(this);
+  size_t length = writeStatus(buffer, bufferSize, _dirtyMask);
+
+  // Keep the changes pending if the caller has to retry with a larger buffer
+  if (length < bufferSize) _dirtyMask = 0;
+  return length;
+}
+
+String AvantPinSet::buildStatus(uint64_t mask) {
+  return writerString([&](char* buffer, size_t bufferSize) { return writeStatus(buffer, bufferSize, mask); });
+}
+
+String AvantPinSet::pinStatus(int pinNum) {
+  return pinStatus(getHandle(pinNum));
+}
+
+String AvantPinSet::pinStatus(PinHandle handle) {
+  AVANT_PINSET_PROFILE(PROFILE_PIN_STATUS);
+  TaskLock lock(this);
+  const PinData* pin = handleData(handle);
+  return writerString([&](char* buffer, size_t bufferSize) { return writePinStatus(pin, buffer, bufferSize); });
+}
+
+size_t AvantPinSet::systemStatus(char* buffer, size_t bufferSize) {
+  AVANT_PINSET_PROFILE(PROFILE_SYSTEM_STATUS);
+  TaskLock lock(this);
+  return writeStatus(buffer, bufferSize, ALL_PINS);
+}
+
+size_t AvantPinSet::writeStatus(char* buffer, size_t bufferSize, uint64_t mask) {
+  StatusWriter out(buffer, bufferSize);
+  bool first = true;
+
+  out.append("{");
+  for (size_t i = 0; i < _pinCount; i++) {
+    if (!(mask & (1ULL << i))) continue;
+
+    if (!first) out.append(",");
+    first = false;
+    out.append("\"");
+    out.appendInt(_pins[i].pinNumber);
+    out.append("\":");
+    out.appendPinValue(_pins[i]);
+  }
+  out.append("}");
+  return out.finish();
+}
+
+size_t AvantPinSet::packedStatus(uint8_t* buffer, size_t bufferSize) {
+  TaskLock lock(this);
+  return writePackedStatus(buffer, bufferSize, ALL_PINS);
+}
+
+size_t AvantPinSet::packedStatusDelta(uint8_t* buffer, size_t bufferSize) {
+  TaskLock lock(this);
+  size_t length = writePackedStatus(buffer, bufferSize, _dirtyMask);
+
+  // Keep the changes pending if the caller has to retry with a larger buffer
+  if (length <= bufferSize) _dirtyMask = 0;
+  return length;
+}
+
+size_t AvantPinSet::writePackedStatus(uint8_t* buffer, size_t bufferSize, uint64_t mask) {
+  size_t count = 0;
+  for (size_t i = 0; i < _pinCount; i++) {
+    if (mask & (1ULL << i)) count++;
+  }
+
+  size_t length = 1 + count * PIN_PACKED_STATUS_SIZE;
+  if (!buffer || length > bufferSize) return length;
+
+  uint8_t* out = buffer;
+  *out++ = (uint8_t)count;
+  for (size_t i = 0; i < _pinCount; i++) {
+    if (!(mask & (1ULL << i))) continue;
+
+    // Same grouping of modes as the "mode" text of pinStatus()
+    const PinData& pin = _pins[i];
+    PinModeState mode = pin.currentMode;
+    if (pin.sequence) mode = PIN_MODE_SEQUENCE;
+    else if (mode == PIN_MODE_HOLD) mode = PIN_MODE_FADING;
+
+    out[0] = (uint8_t)pin.pinNumber;
+    out[1] = mode;
+    writeLe16(out + 2, (uint16_t)pin.currentValue);
+    out += PIN_PACKED_STATUS_SIZE;
+  }
+  return length;
+}
+
+size_t AvantPinSet::pinStatus(int pinNum, char* buffer, size_t bufferSize) {
+  return pinStatus(getHandle(pinNum), buffer, bufferSize);
+}
+
+size_t AvantPinSet::pinStatus(PinHandle handle, char* buffer, size_t bufferSize) {
+  AVANT_PINSET_PROFILE(PROFILE_PIN_STATUS);
+  TaskLock lock(this);
+  return writePinStatus(handleData(handle), buffer, bufferSize);
+}
+
+size_t AvantPinSet::writePinStatus(const PinData* pin, char* buffer, size_t bufferSize) {
+  StatusWriter out(buffer, bufferSize);
+  if (pin) {
+    out.append("{\"mode\":\"");
+    out.append(modeName(*pin));
+    out.append("\",\"value\":");
+    out.appendPinValue(*pin);
+    out.append("}");
+  } else {
+    out.append("{\"error\":\"Pin not managed by this instance\"}");
+  }
+  return out.finish();
+}
+
+// --- Runtime Statistics ---
+PinSetStats AvantPinSet::stats() const {
+  TaskLock lock(this);
+  return _stats;
+}
+
+String AvantPinSet::statsJson() const {
+  PinSetStats current = stats();
+  return writerString([&](char* buffer, size_t bufferSize) { return writeStats(current, buffer, bufferSize); });
+}
+
+size_t AvantPinSet::statsJson(char* buffer, size_t bufferSize) const {
+  return writeStats(stats(), buffer, bufferSize);
+}
+
+void AvantPinSet::resetStats() {
+  TaskLock lock(this);
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+// --- Wall-Clock Rules ---
+int AvantPinSet::addRule(const PinRule& rule) {
+  TaskLock lock(this);
+  if (rule.command.type > PIN_CMD_PWM_FADE_TIME || !getHandle(rule.command.pinNumber).isValid()) return -1;
+  if ((rule.days & RULE_EVERY_DAY) == 0 || rule.anchor > RULE_AT_SUNSET) return -1;
+  if (rule.anchor == RULE_AT_TIME ? (rule.minutes < 0 || rule.minutes >= 24 * 60) : (rule.minutes < -720 || rule.minutes > 720)) return -1;
+  if (_ruleCount >= AVANT_PINSET_MAX_RULES) return -1;
+
+  // Lowest free id
+  uint8_t ruleId = 0;
+  while (_ruleSlots & (1UL << ruleId)) ruleId++;
+
+  _rules[ruleId] = rule;
+  _ruleNext[ruleId] = 0; // Scheduled by the next update()
+  _ruleSlots |= 1UL << ruleId;
+  _ruleOrder[_ruleCount++] = ruleId;
+  sortRules();
+  requestRuleCheck();
+  return ruleId;
+}
+
+bool AvantPinSet::removeRule(int ruleId) {
+  TaskLock lock(this);
+  if (ruleId < 0 || ruleId >= AVANT_PINSET_MAX_RULES || !(_ruleSlots & (1UL << ruleId))) return false;
+
+  _ruleSlots &= ~(1UL << ruleId);
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < _ruleCount; i++) {
+    if (_ruleOrder[i] != ruleId) _ruleOrder[kept++] = _ruleOrder[i];
+  }
+  _ruleCount = kept;
+  return true;
+}
+
+void AvantPinSet::clearRules() {
+  TaskLock lock(this);
+  _ruleSlots = 0;
+  _ruleCount = 0;
+}
+
+void AvantPinSet::setLocation(float latitude, float longitude) {
+  TaskLock lock(this);
+  _latitude = latitude;
+  _longitude = longitude;
+  _locationSet = true;
+
+  // Sunrise and sunset times move with the location, let the next update() schedule them again
+  for (uint8_t i = 0; i < _ruleCount; i++) {
+    if (_rules[_ruleOrder[i]].anchor != RULE_AT_TIME) _ruleNext[_ruleOrder[i]] = 0;
+  }
+  sortRules();
+  requestRuleCheck();
+}
+
+time_t AvantPinSet::nextRuleTime() const {
+  TaskLock lock(this);
+  if (_ruleCount == 0) return 0;
+  int64_t fireTime = _ruleNext[_ruleOrder[0]];
+  return (fireTime == 0 || fireTime == RULE_NEVER) ? 0 : (time_t)fireTime;
+}
+
+void AvantPinSet::runRules(uint64_t now) {
+  struct timeval wall;
+  gettimeofday(&wall, nullptr);
+  int64_t wallSeconds = (int64_t)wall.tv_sec;
+
+  // Look again after the recheck interval at the latest, the clock may be set or corrected meanwhile
+  _ruleDeadline = now + AVANT_PINSET_RULE_RECHECK_MS * 1000ULL;
+  if (wallSeconds < AVANT_PINSET_RULE_MIN_TIME) return;
+
+  // Fire due rules in fire order and schedule new ones. Rules that could not be scheduled are
+  // tried again, a polar night ends eventually.
+  for (uint8_t i = 0; i < _ruleCount; i++) {
+    uint8_t ruleId = _ruleOrder[i];
+    int64_t fireTime = _ruleNext[ruleId];
+    if (fireTime > wallSeconds && fireTime != RULE_NEVER) continue;
+
+    // A rule that is far overdue was jumped over by a clock correction, it is skipped
+    if (fireTime != 0 && fireTime <= wallSeconds && wallSeconds - fireTime <= AVANT_PINSET_RULE_RECHECK_MS / 1000) {
+      applyCommand(_rules[ruleId].command);
+    }
+    _ruleNext[ruleId] = nextOccurrence(_rules[ruleId], wallSeconds);
+  }
+  sortRules();
+
+  // Wake up exactly when the next rule is due, if that is sooner than the recheck
+  if (_ruleCount > 0 && _ruleNext[_ruleOrder[0]] != RULE_NEVER) {
+    int64_t waitUs = (_ruleNext[_ruleOrder[0]] - wallSeconds) * 1000000LL - wall.tv_usec;
+    if (waitUs < (int64_t)(AVANT_PINSET_RULE_RECHECK_MS * 1000ULL)) _ruleDeadline = now + (waitUs > 0 ? (uint64_t)waitUs : 0);
+  }
+}
+
+void AvantPinSet::sortRules() {
+  // Insertion sort, the list is short and mostly in order already. Rules waiting to be scheduled (0) go first.
+  for (uint8_t i = 1; i < _ruleCount; i++) {
+    uint8_t ruleId = _ruleOrder[i];
+    uint8_t j = i;
+    while (j > 0 && _ruleNext[_ruleOrder[j - 1]] > _ruleNext[ruleId]) {
+      _ruleOrder[j] = _ruleOrder[j - 1];
+      j--;
+    }
+    _ruleOrder[j] = ruleId;
+  }
+}
+
+int64_t AvantPinSet::nextOccurrence(const PinRule& rule, int64_t after) const {
+  if (rule.anchor != RULE_AT_TIME && !_locationSet) return RULE_NEVER;
+
+  // Walk the local calendar from today, eight days cover every day mask
+  time_t start = (time_t)after;
+  struct tm today;
+  localtime_r(&start, &today);
+
+  for (int day = 0; day <= 7; day++) {
+    struct tm date = today;
+    date.tm_mday += day;
+    date.tm_hour = 12; // Noon, so normalizing never lands on the wrong side of a DST change
+    date.tm_min = 0;
+    date.tm_sec = 0;
+    date.tm_isdst = -1;
+    if (mktime(&date) == (time_t)-1) return RULE_NEVER;
+    if (!(rule.days & (1 << date.tm_wday))) continue;
+
+    int64_t fireTime;
+    if (rule.anchor == RULE_AT_TIME) {
+      date.tm_hour = rule.minutes / 60;
+      date.tm_min = rule.minutes % 60;
+      date.tm_isdst = -1;
+      fireTime = (int64_t)mktime(&date);
+    } else {
+      float minutes;
+      if (!sunEventMinutes(date.tm_yday + 1, _latitude, _longitude, rule.anchor == RULE_AT_SUNRISE, minutes)) continue;
+      int64_t midnight = daysFromCivil(date.tm_year + 1900, date.tm_mon + 1, date.tm_mday) * 86400;
+      fireTime = midnight + (int64_t)lroundf(minutes) * 60 + rule.minutes * 60;
+    }
+    if (fireTime > after) return fireTime;
+  }
+  return RULE_NEVER; // No sunrise or sunset on any matching day this week
+}
+
+void AvantPinSet::requestRuleCheck() {
+  _ruleDeadline = 0;
+
+#if AVANT_PINSET_HAS_FREERTOS
+  // Let the scheduler task schedule the rule now rather than at its next deadline
+  if (_taskHandle && xTaskGetCurrentTaskHandle() != _taskHandle) xTaskNotifyGive(_taskHandle);
+#endif
+}
+
+// --- Snapshots ---
+size_t AvantPinSet::writeSnapshot(uint8_t* buffer, size_t bufferSize) const {
+  TaskLock lock(this);
+  size_t length = sizeof(SnapshotHeader) + _pinCount * sizeof(SnapshotEntry);
+  if (!buffer || length > bufferSize) return length;
+
+  uint64_t now = clockMicros();
+  uint8_t* out = buffer + sizeof(SnapshotHeader);
+
+  for (size_t i = 0; i < _pinCount; i++) {
+    const PinData& pin = _pins[i];
+    SnapshotEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.pinNumber = (uint8_t)pin.pinNumber;
+    entry.mode = pin.currentMode;
+    entry.curve = pin.fadeCurve;
+    entry.pwmResolution = pin.pwmResolution;
+    entry.pwmFrequency = pin.pwmFrequency;
+    entry.value = (uint16_t)pin.currentValue;
+    entry.finishValue = (uint16_t)pin.targetValue;
+
+    bool timed = _timerSlot[i] >= 0;
+    uint64_t deadline = timed ? _timerHeap[_timerSlot[i]].deadline : 0;
+
+    switch (pin.currentMode) {
+      case PIN_MODE_HOLD:
+        entry.startValue = (uint16_t)pin.startPwmValue;
+        entry.finishValue = (uint16_t)pin.finishPwmValue;
+        entry.fadeMs = (uint32_t)min(pin.fadeDuration / 1000, (uint64_t)UINT32_MAX);
+        break;
+      case PIN_MODE_FADING:
+        // Saved at the value reached, the rest of the fade continues from there
+        entry.value = (uint16_t)fadePosition(pin, now);
+        entry.finishValue = (uint16_t)pin.finishPwmValue;
+        deadline = pin.fadeStartTime + pin.duration;
+        if (pin.fadeGroup != NO_GROUP) timed = true; // Group members share the first member's timer, each is restored on its own
+        break;
+      case PIN_MODE_PULSE:
+        // A pulse is not repeated after a restart, the pin comes back at its idle level
+        entry.mode = PIN_MODE_DIGITAL;
+        timed = false;
+        break;
+      default:
+        break;
+    }
+
+    // The keyframes of a sequence live in the sketch, so the pin is restored at its current value
+    if (pin.sequence) {
+      entry.mode = PIN_MODE_PWM;
+      timed = false;
+    }
+
+    if (timed) {
+      // Rounded up, and at least 1 ms, so an overdue action still runs after the restore
+      uint64_t remainingMs = (deadline > now) ? (deadline - now + 999) / 1000 : 1;
+      entry.remainingMs = (uint32_t)constrain(remainingMs, (uint64_t)1, (uint64_t)UINT32_MAX);
+    }
+
+    memcpy(out + i * sizeof(SnapshotEntry), &entry, sizeof(entry));
+  }
+
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = SNAPSHOT_MAGIC;
+  header.pinListHash = _pinListHash;
+  header.checksum = fnv1a(out, _pinCount * sizeof(SnapshotEntry));
+  header.version = SNAPSHOT_VERSION;
+  header.count = (uint8_t)_pinCount;
+  memcpy(buffer, &header, sizeof(header));
+  return length;
+}
+
+bool AvantPinSet::restoreSnapshot(const uint8_t* snapshot, size_t length) {
+  TaskLock lock(this);
+  int entries = snapshotEntries(snapshot, length);
+  if (entries < 0) return false;
+
+  for (int e = 0; e < entries; e++) {
+    const uint8_t* entry = snapshot + sizeof(SnapshotHeader) + e * sizeof(SnapshotEntry);
+    PinHandle handle = getHandle(entry[offsetof(SnapshotEntry, pinNumber)]);
+    if (handle.isValid()) restorePin((uint8_t)handle.index, entry, false);
+  }
+  return true;
+}
+
+bool AvantPinSet::flushSnapshot() {
+  TaskLock lock(this);
+  if (_snapshotMode == SNAPSHOT_OFF) return false;
+  _snapshotChanged = false;
+  return storeSnapshot(clockMicros(), _snapshotMode == SNAPSHOT_NVS);
+}
+
+void AvantPinSet::clearSnapshot() {
+  TaskLock lock(this);
+  rtcSnapshot[0] = 0; // Breaks the magic number
+  _snapshotChanged = false;
+  _snapshotNvsPending = false;
+  _snapshotNvsHash = 0;
+#if defined(ARDUINO_ARCH_ESP32)
+  if (_snapshotMode == SNAPSHOT_NVS) SnapshotNvs(_pinListHash, NVS_READWRITE).erase();
+#endif
+}
+
+void AvantPinSet::restorePin(uint8_t index, const uint8_t* entryData, bool startup) {
+  SnapshotEntry entry;
+  memcpy(&entry, entryData, sizeof(entry));
+
+  PinData& pin = _pins[index];
+  PinHandle handle;
+  handle.index = index;
+  FadeCurve curve = (entry.curve <= FADE_CIE) ? (FadeCurve)entry.curve : FADE_LINEAR;
+  uint64_t remainingUs = entry.remainingMs * 1000ULL;
+
+  // Apply the saved PWM settings first, so the saved values are in range
+  if (entry.pwmFrequency != pin.pwmFrequency || entry.pwmResolution != pin.pwmResolution) {
+    pwmAttach(handle, entry.pwmFrequency, entry.pwmResolution);
+  }
+
+  switch (entry.mode) {
+    case PIN_MODE_PWM:
+      if (remainingUs > 0) {
+        pwmSetTimeUs(handle, entry.value, remainingUs);
+      } else {
+        pwmSet(handle, entry.value);
+      }
+      break;
+
+    case PIN_MODE_HOLD:
+      pwmFadeTimeUs(handle, entry.startValue, entry.finishValue, remainingUs, entry.fadeMs * 1000ULL, curve);
+      break;
+
+    case PIN_MODE_FADING:
+      pwmFade(handle, entry.value, entry.finishValue, entry.remainingMs, curve);
+      break;
+
+    default: {
+      int state = entry.value ? HIGH : LOW;
+      if (startup) {
+        // Latch the level before the output is enabled, so the pin does not show LOW first
+        if (isVirtual(pin)) {
+          writeDigital(pin, state);
+        } else {
+          uint64_t bit = 1ULL << pin.pinNumber;
+          writeDigitalMasks(state == HIGH ? bit : 0, state == HIGH ? 0 : bit);
+        }
+        setDigitalOutput(pin);
+      }
+      if (remainingUs > 0) {
+        digitalSetTimeUs(handle, state, remainingUs);
+      } else {
+        digitalSet(handle, state);
+      }
+      break;
+    }
+  }
+}
+
+int AvantPinSet::fadePosition(const PinData& pin, uint64_t now) {
+  if (pin.fadeGroup != NO_GROUP) {
+    return groupFadeValue(pin, easeProgress(pin.fadeCurve, groupProgress(pin, now), pin.finishPwmValue < pin.startPwmValue));
+  }
+  if (!pin.hwFadeActive) return fadeValue(pin);
+
+  // The LEDC peripheral does not report its position; hardware fades are linear, so interpolate
+  uint64_t elapsed = min(now - pin.fadeStartTime, pin.duration);
+  int64_t distance = (int64_t)pin.finishPwmValue - pin.startPwmValue;
+  return pin.startPwmValue + (int)((pin.duration > 0) ? distance * (int64_t)elapsed / (int64_t)pin.duration : distance);
+}
+
+void AvantPinSet::serviceSnapshot(uint64_t now) {
+  if (_snapshotMode == SNAPSHOT_OFF) return;
+
+  // RTC memory is cheap to write: refresh it on every change, and now and then while timers
+  // run so their remaining time stays current. Flash is only written for changes, coalesced.
+  if (_snapshotChanged && _snapshotMode == SNAPSHOT_NVS) _snapshotNvsPending = true;
+  bool nvsDue = _snapshotNvsPending && now >= _snapshotNvsDue;
+  bool rtcDue = _snapshotChanged || (_timerCount > 0 && now - _snapshotRtcTime >= AVANT_PINSET_SNAPSHOT_RTC_INTERVAL_MS * 1000ULL);
+  _snapshotChanged = false;
+
+  if (rtcDue || nvsDue) storeSnapshot(now, nvsDue);
+}
+
+uint64_t AvantPinSet::snapshotDeadline() const {
+  if (_snapshotMode == SNAPSHOT_OFF) return NO_DEADLINE_US;
+  if (_snapshotChanged) return 0;
+
+  uint64_t deadline = _snapshotNvsPending ? _snapshotNvsDue : NO_DEADLINE_US;
+  if (_timerCount > 0) deadline = min(deadline, (uint64_t)(_snapshotRtcTime + AVANT_PINSET_SNAPSHOT_RTC_INTERVAL_MS * 1000ULL));
+  return deadline;
+}
+
+bool AvantPinSet::storeSnapshot(uint64_t now, bool toNvs) {
+  uint8_t* rtc = (uint8_t*)rtcSnapshot;
+  size_t length = writeSnapshot(rtc, sizeof(rtcSnapshot));
+  _snapshotRtcTime = now;
+  if (length > sizeof(rtcSnapshot)) {
+    // Too many pins for AVANT_PINSET_SNAPSHOT_SIZE; make sure an older snapshot is not restored instead
+    rtcSnapshot[0] = 0;
+    return false;
+  }
+  if (!toNvs) return true;
+
+  _snapshotNvsPending = false;
+  _snapshotNvsDue = now + AVANT_PINSET_SNAPSHOT_NVS_INTERVAL_MS * 1000ULL;
+#if defined(ARDUINO_ARCH_ESP32)
+  // Identical contents, e.g. a light switched on and off again, are not written twice
+  uint32_t checksum = snapshotHeader(rtc).checksum;
+  if (checksum == _snapshotNvsHash) return true;
+  if (!SnapshotNvs(_pinListHash, NVS_READWRITE).write(rtc, length)) return false;
+  _snapshotNvsHash = checksum;
+#endif
+  return true;
+}
+
+// --- Profiling ---
+bool AvantPinSet::profilingEnabled() {
+#ifdef AVANT_PINSET_PROFILING
+  return true;
+#else
+  return false;
+#endif
+}
+
+PinSetProfile AvantPinSet::profile(PinSetProfilePath path) {
+  PinSetProfile result = {0, 0, 0, 0};
+#ifdef AVANT_PINSET_PROFILING
+  if (path < PROFILE_PATH_COUNT) result = profiles[path];
+#else
+  (void)path;
+#endif
+  return result;
+}
+
+void AvantPinSet::resetProfile() {
+#ifdef AVANT_PINSET_PROFILING
+  memset(profiles, 0, sizeof(profiles));
+#endif
 }
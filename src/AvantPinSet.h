@@ -8,28 +8,403 @@
 #define AVANT_PIN_SET_H
 
 #include <Arduino.h>
-#include <vector>
+#include <array>
 #include <functional>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include "AvantPinSetCallback.h"
+#include "AvantPinSetDriver.h"
 
-// Define the type for the optional callback function
-typedef std::function<void(int pinNum)> TimedActionCallback;
+// Size of the GPIO-number-to-index lookup table (one entry per GPIO of the target chip)
+#ifndef AVANT_PINSET_MAX_GPIO
+#ifdef SOC_GPIO_PIN_COUNT
+#define AVANT_PINSET_MAX_GPIO SOC_GPIO_PIN_COUNT
+#else
+#define AVANT_PINSET_MAX_GPIO 64
+#endif
+#endif
 
-// Structure to hold all data for a single pin
+// Virtual pins, the outputs of drivers attached with AvantPinSet::attachDriver(), are numbered
+// from AVANT_PINSET_VIRTUAL_PIN_BASE, above every GPIO number
+#ifndef AVANT_PINSET_VIRTUAL_PIN_BASE
+#define AVANT_PINSET_VIRTUAL_PIN_BASE 100
+#endif
+#ifndef AVANT_PINSET_MAX_VIRTUAL_PINS
+#define AVANT_PINSET_MAX_VIRTUAL_PINS 64
+#endif
+
+// Output drivers one instance can have attached
+#ifndef AVANT_PINSET_MAX_DRIVERS
+#define AVANT_PINSET_MAX_DRIVERS 4
+#endif
+
+#if AVANT_PINSET_VIRTUAL_PIN_BASE < AVANT_PINSET_MAX_GPIO || AVANT_PINSET_VIRTUAL_PIN_BASE + AVANT_PINSET_MAX_VIRTUAL_PINS > 256
+#error "Virtual pins must lie between AVANT_PINSET_MAX_GPIO and 255"
+#endif
+
+// Maximum number of pins one instance can manage (one bit each in the change-tracking mask)
+#define AVANT_PINSET_MAX_PINS 64
+
+// Capacity of the cross-task command queue (must be a power of two)
+#ifndef AVANT_PINSET_QUEUE_SIZE
+#define AVANT_PINSET_QUEUE_SIZE 16
+#endif
+
+// Actions waiting in the per-pin action queues of one instance, shared by all its pins (at most 255)
+#ifndef AVANT_PINSET_ACTION_POOL_SIZE
+#define AVANT_PINSET_ACTION_POOL_SIZE 8
+#endif
+
+// Actions one pin can have waiting behind its current action
+#ifndef AVANT_PINSET_PIN_QUEUE_DEPTH
+#define AVANT_PINSET_PIN_QUEUE_DEPTH 4
+#endif
+
+#if AVANT_PINSET_ACTION_POOL_SIZE > 255
+#error "AVANT_PINSET_ACTION_POOL_SIZE must not exceed 255"
+#endif
+
+// Hardware LEDC fades and per-pin LEDC channels need the LEDC API of the Arduino-ESP32 3.x core
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+#define AVANT_PINSET_HAS_LEDC_FADE 1
+#define AVANT_PINSET_HAS_LEDC_CHANNEL 1
+#else
+#define AVANT_PINSET_HAS_LEDC_CHANNEL 0
+#define AVANT_PINSET_HAS_LEDC_FADE 0
+#endif
+
+// Default PWM frequency (Hz) and resolution (bits) for pins not configured with pwmAttach()
+#ifndef AVANT_PINSET_PWM_FREQUENCY
+#define AVANT_PINSET_PWM_FREQUENCY 1000
+#endif
+#ifndef AVANT_PINSET_PWM_RESOLUTION
+#define AVANT_PINSET_PWM_RESOLUTION 8
+#endif
+
+// Shortest interval between two software fade steps (microseconds)
+#ifndef AVANT_PINSET_MIN_FADE_TICK_US
+#define AVANT_PINSET_MIN_FADE_TICK_US 250
+#endif
+
+// Shortest wait sleepUntilNextEvent() spends in light sleep, and how long before the deadline
+// it wakes up to leave time for the wakeup itself (microseconds)
+#ifndef AVANT_PINSET_MIN_SLEEP_US
+#define AVANT_PINSET_MIN_SLEEP_US 3000
+#endif
+#ifndef AVANT_PINSET_SLEEP_WAKEUP_US
+#define AVANT_PINSET_SLEEP_WAKEUP_US 1000
+#endif
+
+#if AVANT_PINSET_SLEEP_WAKEUP_US >= AVANT_PINSET_MIN_SLEEP_US
+#error "AVANT_PINSET_SLEEP_WAKEUP_US must be shorter than AVANT_PINSET_MIN_SLEEP_US"
+#endif
+
+// Pin groups one instance can hold, pins per group, and the longest group name (including the terminator)
+#ifndef AVANT_PINSET_MAX_GROUPS
+#define AVANT_PINSET_MAX_GROUPS 4
+#endif
+#ifndef AVANT_PINSET_GROUP_SIZE
+#define AVANT_PINSET_GROUP_SIZE 8
+#endif
+#ifndef AVANT_PINSET_GROUP_NAME_LENGTH
+#define AVANT_PINSET_GROUP_NAME_LENGTH 16
+#endif
+
+// Largest snapshot kept by SNAPSHOT_RTC / SNAPSHOT_NVS, in bytes (16 plus 24 per pin, so 20 pins by default)
+#ifndef AVANT_PINSET_SNAPSHOT_SIZE
+#define AVANT_PINSET_SNAPSHOT_SIZE 512
+#endif
+
+// How often the RTC snapshot is refreshed while timers run, so their remaining time stays current (ms)
+#ifndef AVANT_PINSET_SNAPSHOT_RTC_INTERVAL_MS
+#define AVANT_PINSET_SNAPSHOT_RTC_INTERVAL_MS 1000
+#endif
+
+// Shortest interval between two NVS writes of the snapshot, to limit flash wear (ms)
+#ifndef AVANT_PINSET_SNAPSHOT_NVS_INTERVAL_MS
+#define AVANT_PINSET_SNAPSHOT_NVS_INTERVAL_MS 10000
+#endif
+
+// Number of wall-clock rules one instance can hold (see AvantPinSet::addRule())
+#ifndef AVANT_PINSET_MAX_RULES
+#define AVANT_PINSET_MAX_RULES 8
+#endif
+
+// Longest the rule scheduler sleeps before checking the wall clock again, so clock
+// corrections (NTP, DST) are picked up (ms)
+#ifndef AVANT_PINSET_RULE_RECHECK_MS
+#define AVANT_PINSET_RULE_RECHECK_MS 60000
+#endif
+
+// Wall-clock times before this (2020-01-01) mean the clock has not been set yet
+#define AVANT_PINSET_RULE_MIN_TIME 1577836800L
+
+#if AVANT_PINSET_MAX_RULES > 32
+#error "AVANT_PINSET_MAX_RULES must not exceed 32"
+#endif
+
+// Highest supported PWM resolution
+#define AVANT_PINSET_MAX_PWM_RESOLUTION 16
+
+#if (AVANT_PINSET_QUEUE_SIZE & (AVANT_PINSET_QUEUE_SIZE - 1)) != 0
+#error "AVANT_PINSET_QUEUE_SIZE must be a power of two"
+#endif
+
+// The scheduler task needs FreeRTOS, which the ESP32 core always provides
+#if defined(ARDUINO_ARCH_ESP32)
+#define AVANT_PINSET_HAS_FREERTOS 1
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#else
+#define AVANT_PINSET_HAS_FREERTOS 0
+#endif
+
+// Precise pulses are timed by esp_timer one-shots; elsewhere update() writes the edges
+#if defined(ARDUINO_ARCH_ESP32)
+#define AVANT_PINSET_HAS_ESP_TIMER 1
+#include <esp_timer.h>
+#else
+#define AVANT_PINSET_HAS_ESP_TIMER 0
+#endif
+
+
+// Operating mode and phase of a managed pin
+enum PinModeState : uint8_t {
+  PIN_MODE_IDLE = 0,  // Not yet driven by the library
+  PIN_MODE_DIGITAL,   // Digital output (HIGH/LOW)
+  PIN_MODE_PWM,       // PWM output
+  PIN_MODE_HOLD,      // Holding the start PWM value before a fade
+  PIN_MODE_FADING,    // Actively fading between two PWM values
+  PIN_MODE_SEQUENCE,  // Holding a keyframe of a running sequence
+  PIN_MODE_PULSE      // Running a pulse or pulse train started with pulse()/pulseTrain()
+};
+
+// Easing curve applied to a fade
+enum FadeCurve : uint8_t {
+  FADE_LINEAR = 0,  // Constant rate of change
+  FADE_GAMMA,       // Gamma 2.2, perceptually even LED brightness
+  FADE_EASE_IN,     // Starts slowly and accelerates
+  FADE_EASE_OUT,    // Starts quickly and decelerates
+  FADE_EASE_IN_OUT, // Slow at both ends
+  FADE_CIE          // CIE 1931 lightness, perceptually even LED brightness
+};
+
+// Keyframe curve value that jumps straight to the keyframe value and holds it
+static const uint8_t KEYFRAME_STEP = 0xFF;
+
+// One step of a PWM sequence started with AvantPinSet::pwmSequence()
+struct PinKeyframe {
+  uint16_t value;  // PWM value of the keyframe
+  uint16_t timeMs; // Time to fade to the value, or to hold it for KEYFRAME_STEP (milliseconds)
+  uint8_t curve;   // FadeCurve to fade along, or KEYFRAME_STEP
+};
+
+// Where an AvantPinSet keeps its snapshot across reboots, see the constructor
+enum PinSnapshotMode : uint8_t {
+  SNAPSHOT_OFF = 0, // Every pin starts digital LOW (default)
+  SNAPSHOT_RTC,     // RTC memory: survives restarts, OTA, watchdog and brownout resets, but not power loss
+  SNAPSHOT_NVS      // RTC memory, mirrored to NVS flash at most every AVANT_PINSET_SNAPSHOT_NVS_INTERVAL_MS
+};
+
+// Structure to hold all data for a single pin. The fields a fade tick touches come first, in one
+// contiguous block of about 75 bytes, so a tick reads three or four 32-byte ESP32 cache lines of
+// the pin rather than the whole struct (the table is not cache-line aligned). Setup-time and
+// callback data follow. Scheduler deadlines are kept out of this struct, in the timer heap
+// (see PinTimer), so update() only touches the pins whose timer is due.
 struct PinData {
-  int pinNumber;
-  String currentMode;      // "digital", "pwm", "fading"
-  int currentValue;        // HIGH/LOW for digital, 0-255 for PWM
-  bool isTimerActive;      // Flag to indicate if a timed action is in progress
-  unsigned long startTime; // Start time for timed actions (millis())
-  unsigned long duration;  // Duration for timed actions (milliseconds)
-  int targetValue;         // Target value for timed actions (HIGH/LOW or PWM)
+  // --- Hot: read or written on every fade tick ---
+  uint64_t fadeAccumulator; // Distance travelled from the start value (32.32 fixed point)
+  uint64_t fadeStep;        // Distance travelled per microsecond (32.32 fixed point)
+  uint64_t fadeLastTime;    // Time the software ramp was last advanced (microseconds)
+  uint64_t fadeStartTime;   // Start time for the actual fade operation (microseconds)
+  uint64_t duration;        // Duration for timed actions (microseconds)
+  uint32_t fadeTick;        // Interval between software fade steps (microseconds)
   int startPwmValue;       // Starting PWM value for fade operations
   int finishPwmValue;      // Finishing PWM value for fade operations
-  bool isHoldingBeforeFade; // Flag to indicate if pin is holding before fading
-  unsigned long fadeStartTime; // Start time for the actual fade operation
-  TimedActionCallback callback; // Callback function to execute on completion
+  int currentValue;        // HIGH/LOW for digital, 0 to (2^pwmResolution - 1) for PWM
+  int pinNumber;
+  int writtenPwm;          // Duty last sent to the LEDC channel or analogWrite(), -1 if unknown
+  int pendingPwm;          // Duty waiting for the outermost TaskLock to be released (see _pwmPending)
+  PinModeState currentMode; // Reported as "digital", "pwm", "fading", "sequence" or "pulse"
+  FadeCurve fadeCurve;      // Easing curve of the fade
+  int8_t ledcChannel;      // LEDC channel driving the pin, or LEDC_DETACHED / LEDC_UNAVAILABLE
+  uint8_t pwmResolution;   // PWM resolution in bits
+  bool hwFadeActive;       // Flag to indicate the LEDC peripheral is running the fade
+  volatile bool hwFadeDone; // Set from the LEDC fade-end interrupt
+
+  // --- Cold: touched when an action starts or completes ---
+  uint64_t startTime;      // Start time for timed actions (microseconds)
+  int targetValue;         // Target value for timed actions (HIGH/LOW or PWM)
+  uint64_t fadeDuration;   // Duration of the fade itself (microseconds)
+  uint32_t pwmFrequency;   // PWM frequency in Hz
+  const PinKeyframe* sequence; // Keyframes of the running sequence, nullptr if none
+  uint16_t sequenceRepeat; // Passes left including the current one, 0 to loop forever
+  uint8_t sequenceLength;  // Number of keyframes in the sequence
+  uint8_t sequenceStep;    // Next keyframe to start
+  uint64_t pulseEdgeTime;  // Time the next pulse edge is due (microseconds)
+  uint32_t pulseOnUs;      // Width of each pulse (microseconds)
+  uint32_t pulseOffUs;     // Gap between pulses of a train (microseconds)
+  volatile uint32_t pulseEdges; // Pulse edges still to be written, 0 when stopped
+  uint8_t pulseLevel;      // Level the pin is driven to during a pulse
+  uint8_t pulseOutput;     // Level last written by the pulse generator
+  bool pulseTimed;         // The edges are written by pulseTimer rather than update()
+  volatile bool pulseDone; // Set from the esp_timer callback after the last edge
+  uint8_t queueHead;       // First action waiting in the pin's action queue, or ACTION_NONE
+  uint8_t queueTail;       // Last action waiting in the queue, or ACTION_NONE
+  uint8_t queueLength;     // Number of actions waiting
+  uint8_t fadeGroup;       // Group whose fade drives the pin, or NO_GROUP
+  uint8_t driverChannel;   // Channel of a virtual pin on its driver
+  PinOutputDriver* driver; // Driver of a virtual pin, nullptr until one is attached
+#if AVANT_PINSET_HAS_ESP_TIMER
+  esp_timer_handle_t pulseTimer; // One-shot timer writing the pulse edges, created on first use
+#endif
+  PinCallback callback;    // Callback function to execute on completion
+};
+
+// Entry of the scheduler's timer heap. Keeping the deadline next to the pin index lets
+// update() and the heap operations work from this packed array alone.
+struct PinTimer {
+  uint64_t deadline;      // Time at which the scheduler next services the pin (microseconds)
+  uint8_t index;          // Index of the pin in the pin table
+};
+
+// Handle to a managed pin, obtained once from AvantPinSet::getHandle() to skip per-call lookups
+struct PinHandle {
+  int16_t index; // Index into the managed pin list, or -1 if invalid
+  bool isValid() const { return index >= 0; }
+};
+
+// Code paths timed when the library is built with AVANT_PINSET_PROFILING
+enum PinSetProfilePath : uint8_t {
+  PROFILE_UPDATE = 0,    // update()
+  PROFILE_FADE_STEP,     // One software fade tick of one pin, inside update()
+  PROFILE_SYSTEM_STATUS, // systemStatus(), both overloads
+  PROFILE_PIN_STATUS,    // pinStatus(), all overloads
+  PROFILE_STATUS_DELTA,  // statusDelta(), both overloads
+  PROFILE_PATH_COUNT
+};
+
+// Timing of one profiled code path, in CPU cycles (microseconds off the ESP32)
+struct PinSetProfile {
+  uint32_t calls;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+};
+
+// Runtime counters of one AvantPinSet, see AvantPinSet::stats()
+struct PinSetStats {
+  uint32_t updateCalls;     // Calls to update(), including those made by the scheduler task
+  uint32_t actionsFired;    // Timed actions, fades and sequences that completed
+  uint32_t callbacksRun;    // Completion callbacks executed
+  uint32_t maxLatenessMicros; // Worst delay between a timer's deadline and update() servicing it
+  uint32_t maxUpdateMicros; // Longest update() call that had timers to service, callbacks included
+  uint32_t eventsDropped;   // Completion events not posted because the event queue was full
+};
+
+// Kind of action a PinEvent reports as completed
+enum PinEventType : uint8_t {
+  PIN_EVENT_TIMER = 0,   // digitalSetTime() or pwmSetTime() switched the pin
+  PIN_EVENT_FADE,        // A fade, or the fade after a hold, reached its finish value
+  PIN_EVENT_SEQUENCE,    // A finite sequence ran its last pass
+  PIN_EVENT_PULSE,       // A pulse or pulse train wrote its last edge
+  PIN_EVENT_GROUP_FADE,  // A group fade completed (reported once, for the group's first pin)
+  PIN_EVENT_IMMEDIATE    // An untimed command from an action queue was applied
+};
+
+// Completion event posted to the queue given to AvantPinSet::setEventQueue()
+struct PinEvent {
+  uint64_t timeUs;      // Scheduler time of the completion, on the clock of nextDeadlineUs() (microseconds)
+  uint32_t latenessUs;  // How long after its deadline the completion was serviced (microseconds)
+  uint16_t value;       // Value the pin was left at (HIGH/LOW for digital pins)
+  uint8_t pinNumber;
+  PinEventType type;
 };
 
+// Operations that can be carried by a PinCommand
+enum PinCommandType : uint8_t {
+  PIN_CMD_DIGITAL_SET = 0, // digitalSet(pin, value)
+  PIN_CMD_DIGITAL_SET_TIME, // digitalSetTime(pin, value, time)
+  PIN_CMD_PWM_SET,          // pwmSet(pin, value)
+  PIN_CMD_PWM_SET_TIME,     // pwmSetTime(pin, value, time)
+  PIN_CMD_PWM_FADE,         // pwmFade(pin, value, value2)
+  PIN_CMD_PWM_FADE_TIME     // pwmFadeTime(pin, value, value2, time)
+};
+
+// Fixed-size pin command, used to hand work to the scheduler without calling into it directly
+struct PinCommand {
+  PinCommandType type; // Operation to perform
+  uint8_t pinNumber;   // Pin to operate on
+  uint16_t value;      // State, PWM value, or fade start value
+  uint16_t value2;     // Fade finish value
+  uint32_t time;       // Delay or hold time in seconds for the timed operations
+};
+
+// Named set of pins faded together, see AvantPinSet::addGroup()
+struct PinGroup {
+  char name[AVANT_PINSET_GROUP_NAME_LENGTH];
+  uint8_t members[AVANT_PINSET_GROUP_SIZE]; // Pin indexes; the first one carries the group's timer
+  uint8_t count;
+};
+
+// How AvantPinSet::queueAction() treats the actions already on the pin
+enum PinQueueMode : uint8_t {
+  QUEUE_APPEND = 0,      // Run after the current action and the ones already waiting
+  QUEUE_REPLACE_PENDING, // Drop the waiting actions, run after the current action
+  QUEUE_REPLACE_ALL      // Drop the waiting actions and replace the current action right away
+};
+
+// Action waiting in a pin's action queue, drawn from the instance's shared pool
+struct PinQueuedAction {
+  PinCommand command;   // Command to apply when the action's turn comes
+  PinCallback callback; // Callback to run when the action completes
+  uint8_t next;         // Next action of the same queue (or of the free list), or ACTION_NONE
+};
+
+// Days of the week a PinRule fires on, combined with |
+enum PinRuleDays : uint8_t {
+  RULE_SUNDAY = 1 << 0,
+  RULE_MONDAY = 1 << 1,
+  RULE_TUESDAY = 1 << 2,
+  RULE_WEDNESDAY = 1 << 3,
+  RULE_THURSDAY = 1 << 4,
+  RULE_FRIDAY = 1 << 5,
+  RULE_SATURDAY = 1 << 6,
+  RULE_WEEKDAYS = 0x3E,
+  RULE_WEEKENDS = 0x41,
+  RULE_EVERY_DAY = 0x7F
+};
+
+// What the minutes of a PinRule are counted from
+enum PinRuleAnchor : uint8_t {
+  RULE_AT_TIME = 0, // Minutes after local midnight (0-1439)
+  RULE_AT_SUNRISE,  // Minutes after sunrise, negative for before (see AvantPinSet::setLocation())
+  RULE_AT_SUNSET    // Minutes after sunset, negative for before
+};
+
+// Wall-clock rule, e.g. "pin 2 HIGH at 07:30 on weekdays", added with AvantPinSet::addRule()
+struct PinRule {
+  PinCommand command;   // Command to apply when the rule fires, as with postCommand()
+  uint8_t days;         // PinRuleDays the rule fires on
+  PinRuleAnchor anchor; // Local time of day, sunrise or sunset
+  int16_t minutes;      // Time of day or offset, in minutes
+};
+
+// Binary frames read by AvantPinSet::applyFrames(). Each frame is its PinCommandType opcode byte and
+// the pin number, followed by the fields of that opcode, little-endian:
+//   PIN_CMD_DIGITAL_SET, PIN_CMD_PWM_SET            value (2)                       4 bytes
+//   PIN_CMD_DIGITAL_SET_TIME, PIN_CMD_PWM_SET_TIME  value (2), time (4)             8 bytes
+//   PIN_CMD_PWM_FADE                                value (2), value2 (2)           6 bytes
+//   PIN_CMD_PWM_FADE_TIME                           value (2), value2 (2), time (4) 10 bytes
+static const size_t PIN_FRAME_MAX_LENGTH = 10;
+
+// Size of one pin in a packed status (pin number, mode, value), see AvantPinSet::packedStatus()
+static const size_t PIN_PACKED_STATUS_SIZE = 4;
+
 class AvantPinSet
 {
 public:
@@ -37,14 +412,89 @@ public:
    * @brief Construct a new AvantPinSet object.
    * @param pinList An array of pin numbers to be managed by this instance.
    * @param numPins The number of pins in the pinList array.
+   *        Pins outside 0..AVANT_PINSET_MAX_GPIO-1 that are not virtual pins (see attachDriver()),
+   *        duplicate entries, and pins beyond AVANT_PINSET_MAX_PINS are ignored.
+   * @param pwmFrequency (Optional) The PWM frequency in Hz for all pins.
+   * @param pwmResolution (Optional) The PWM resolution in bits for all pins (1-16). PWM values
+   *        then range from 0 to 2^pwmResolution - 1. Out-of-range resolutions fall back to 8 bits.
+   *        Both settings need the Arduino-ESP32 3.x core (see pwmAttach()).
+   * @param snapshotMode (Optional) Keep a snapshot of the pin states and restore it here, before
+   *        any pin is driven, so outputs come back after a reboot without first dropping to LOW.
+   *        Only one instance per device should use a snapshot.
    */
-  AvantPinSet(const int pinList[], int numPins);
+  AvantPinSet(const int pinList[], int numPins, uint32_t pwmFrequency = AVANT_PINSET_PWM_FREQUENCY,
+              uint8_t pwmResolution = AVANT_PINSET_PWM_RESOLUTION, PinSnapshotMode snapshotMode = SNAPSHOT_OFF);
+
+  ~AvantPinSet();
+
+  AvantPinSet(const AvantPinSet&) = delete;
+  AvantPinSet& operator=(const AvantPinSet&) = delete;
+
+  /**
+   * @brief Resolve a pin number to a handle that can be reused for fast access.
+   * @param pinNum The pin number to resolve.
+   * @return A PinHandle for the pin; check isValid() if the pin may not be managed.
+   */
+  PinHandle getHandle(int pinNum) const;
 
   /**
    * @brief Must be called in the main loop() to handle all timed and fading actions.
    */
   void update();
 
+  /**
+   * @brief Get the time until the next pending timed or fading action.
+   * @return Milliseconds until update() has work to do (rounded up), 0 if an action is already due,
+   *         or AvantPinSet::NO_DEADLINE if nothing is scheduled.
+   */
+  unsigned long nextDeadlineMs() const;
+
+  // Returned by nextDeadlineMs() when no action is scheduled
+  static const unsigned long NO_DEADLINE = ULONG_MAX;
+
+  /**
+   * @brief Microsecond version of nextDeadlineMs().
+   * @return Microseconds until update() has work to do, 0 if an action is already due,
+   *         or AvantPinSet::NO_DEADLINE_US if nothing is scheduled.
+   */
+  uint64_t nextDeadlineUs() const;
+
+  // Returned by nextDeadlineUs() when no action is scheduled
+  static const uint64_t NO_DEADLINE_US = UINT64_MAX;
+
+  /**
+   * @brief Wait for the next pending action in ESP32 light sleep, then run update() for it.
+   *        The GPIO outputs are held at their levels while the chip sleeps, and the sleep ends
+   *        AVANT_PINSET_SLEEP_WAKEUP_US before the deadline; the rest is waited out awake, so
+   *        actions run on time. Waits shorter than AVANT_PINSET_MIN_SLEEP_US, and waits while a
+   *        GPIO outputs a PWM signal (fading, pulsing, or a duty between 0 and full), which the
+   *        LEDC peripheral cannot keep up in light sleep, are spent in delay() instead.
+   *        A wakeup source the sketch enabled itself, e.g. with esp_sleep_enable_gpio_wakeup(),
+   *        ends the sleep early. Not for use together with beginTask().
+   * @param maxSleepUs (Optional) The longest time to wait, e.g. to service the network in between.
+   * @return True if the chip was in light sleep. False without waiting if nothing is scheduled
+   *         and no maxSleepUs is given, or if the scheduler task is running.
+   */
+  bool sleepUntilNextEvent(uint64_t maxSleepUs = NO_DEADLINE_US);
+
+  /**
+   * @brief Run the scheduler in its own FreeRTOS task instead of from loop().
+   *        The task sleeps until the next deadline or until a new action is scheduled,
+   *        so timing no longer depends on how often the sketch calls update().
+   *        Once started, all methods of this instance are safe to call from any task.
+   * @param core The core to pin the task to (0 or 1).
+   * @param priority The FreeRTOS priority of the task.
+   * @param stackSize The task stack size in bytes; callbacks run on this stack.
+   * @return True if the task is running.
+   */
+  bool beginTask(int core = 1, unsigned int priority = 2, uint32_t stackSize = 4096);
+
+  /**
+   * @brief Stop the scheduler task started by beginTask(). update() must then be called from loop() again.
+   *        Has no effect when called from a callback running on the scheduler task.
+   */
+  void endTask();
+
   // --- Core Digital Methods ---
   /**
    * @brief Set a pin to a specific digital state.
@@ -52,6 +502,7 @@ public:
    * @param state The desired state (HIGH or LOW).
    */
   void digitalSet(int pinNum, int state);
+  void digitalSet(PinHandle handle, int state);
 
   /**
    * @brief Set a pin to a digital state after a specified delay.
@@ -60,42 +511,340 @@ public:
    * @param delaySeconds The delay in seconds before the action occurs.
    * @param callback (Optional) A function to call when the action is complete.
    */
-  void digitalSetTime(int pinNum, int state, unsigned long delaySeconds, TimedActionCallback callback = nullptr);
+  void digitalSetTime(int pinNum, int state, unsigned long delaySeconds, PinCallback callback = nullptr);
+  void digitalSetTime(PinHandle handle, int state, unsigned long delaySeconds, PinCallback callback = nullptr);
+
+  /**
+   * @brief Millisecond and microsecond versions of digitalSetTime(), e.g. for short solenoid pulses.
+   *        The scheduler runs on a 64-bit microsecond clock, so any delay is accurate to
+   *        how often update() is called.
+   * @param delayMs / delayUs The delay before the pin reverts.
+   */
+  void digitalSetTimeMs(int pinNum, int state, unsigned long delayMs, PinCallback callback = nullptr);
+  void digitalSetTimeMs(PinHandle handle, int state, unsigned long delayMs, PinCallback callback = nullptr);
+  void digitalSetTimeUs(int pinNum, int state, uint64_t delayUs, PinCallback callback = nullptr);
+  void digitalSetTimeUs(PinHandle handle, int state, uint64_t delayUs, PinCallback callback = nullptr);
+
+  // --- Pulse Methods ---
+  /**
+   * @brief Drive a pin to the opposite of its current digital state for an exact time, e.g. to open a valve.
+   *        On the ESP32 the edges are written from an esp_timer one-shot, so the pulse width does not
+   *        depend on how often update() is called; completion is still reported through update().
+   *        Elsewhere update() writes the edges.
+   * @param pinNum The pin number to pulse. A pin in PWM mode becomes a digital output idling LOW.
+   * @param widthUs The pulse width in microseconds (at least 1).
+   * @param callback (Optional) A function to call from update() after the pulse has ended.
+   * @return True if the pulse was started.
+   */
+  bool pulse(int pinNum, uint32_t widthUs, PinCallback callback = nullptr);
+  bool pulse(PinHandle handle, uint32_t widthUs, PinCallback callback = nullptr);
+
+  /**
+   * @brief Send a train of equal pulses, e.g. an IR burst or a stepper move.
+   *        Each edge is timed from the start of the train, so timer latency does not accumulate.
+   * @param pinNum The pin number to pulse, see pulse().
+   * @param onUs The width of each pulse in microseconds (at least 1).
+   * @param offUs The gap between two pulses in microseconds.
+   * @param count The number of pulses (at least 1).
+   * @param callback (Optional) A function to call from update() after the last pulse has ended.
+   * @return True if the pulse train was started.
+   */
+  bool pulseTrain(int pinNum, uint32_t onUs, uint32_t offUs, uint16_t count, PinCallback callback = nullptr);
+  bool pulseTrain(PinHandle handle, uint32_t onUs, uint32_t offUs, uint16_t count, PinCallback callback = nullptr);
+
+  // --- Batch Methods ---
+  /**
+   * @brief Set several managed pins to digital states at once.
+   *        Every pin is resolved once, and on the ESP32 the outputs are written through the
+   *        GPIO set/clear registers, so all pins in a register bank switch in the same cycle.
+   * @param mask Bit n selects GPIO n; pins not managed by this instance are ignored.
+   * @param values Bit n is the state (1 = HIGH, 0 = LOW) for GPIO n.
+   */
+  void digitalSetMask(uint64_t mask, uint64_t values);
+
+  /**
+   * @brief Apply a list of commands in order, as if each was called individually.
+   *        PIN_CMD_DIGITAL_SET commands are written together through the set/clear registers.
+   * @param commands The commands to apply.
+   * @param count The number of commands.
+   */
+  void applyBatch(const PinCommand* commands, size_t count);
+
+  // --- Binary Protocol ---
+  /**
+   * @brief Decode binary frames in place (see PIN_FRAME_MAX_LENGTH) and apply them through applyBatch().
+   *        Nothing is copied or allocated, so gateways can hand over a received packet as it is.
+   * @param data The frames, back to back.
+   * @param length The number of bytes in data.
+   * @return The number of bytes consumed. Decoding stops before a frame that is cut off, which the
+   *         caller can keep for the next call, and before an unknown opcode (see frameLength()).
+   */
+  size_t applyFrames(const uint8_t* data, size_t length);
+
+  /**
+   * @brief Get the length of the binary frame starting with an opcode.
+   * @param opcode The first byte of the frame.
+   * @return The frame length in bytes, or 0 for an unknown opcode.
+   */
+  static size_t frameLength(uint8_t opcode);
+
+  /**
+   * @brief Encode a command as a binary frame, e.g. on a gateway or in tests.
+   * @param command The command to encode.
+   * @param buffer The buffer to write the frame into.
+   * @param bufferSize The size of the buffer in bytes.
+   * @return The frame length in bytes, or 0 if the type is unknown or the buffer is too small.
+   */
+  static size_t encodeFrame(const PinCommand& command, uint8_t* buffer, size_t bufferSize);
 
   // --- Core PWM Methods ---
+  /**
+   * @brief Change the PWM frequency and resolution of a single pin.
+   *        On the Arduino-ESP32 3.x core the pin's LEDC channel is looked up once and cached,
+   *        so PWM writes go straight to the LEDC registers. On other cores pins stay at the
+   *        analogWrite() default of 8 bits and this method returns false. Values of a PWM or fade action already running on the pin are not rescaled.
+   * @param pinNum The pin number to configure.
+   * @param frequency The PWM frequency in Hz.
+   * @param resolutionBits The PWM resolution in bits (1-16).
+   * @return True if the configuration was applied.
+   */
+  bool pwmAttach(int pinNum, uint32_t frequency, uint8_t resolutionBits);
+  bool pwmAttach(PinHandle handle, uint32_t frequency, uint8_t resolutionBits);
+
+  /**
+   * @brief Get the largest PWM value a pin accepts at its configured resolution.
+   * @param pinNum The pin number to query.
+   * @return 2^resolution - 1 (255 at the default 8 bits), or 0 if the pin is not managed.
+   */
+  int pwmMaxValue(int pinNum) const;
+  int pwmMaxValue(PinHandle handle) const;
+
   /**
    * @brief Set a pin to a specific PWM value.
    * @param pinNum The pin number to set.
-   * @param pwmValue The PWM duty cycle (0-255).
+   * @param pwmValue The PWM duty cycle (0 to pwmMaxValue()).
    */
   void pwmSet(int pinNum, int pwmValue);
+  void pwmSet(PinHandle handle, int pwmValue);
 
   /**
    * @brief Set a pin to a PWM value after a specified delay.
    * @param pinNum The pin number to set.
-   * @param pwmValue The target PWM duty cycle (0-255).
+   * @param pwmValue The target PWM duty cycle (0 to pwmMaxValue()).
    * @param delaySeconds The delay in seconds before the action occurs.
    * @param callback (Optional) A function to call when the action is complete.
    */
-  void pwmSetTime(int pinNum, int pwmValue, unsigned long delaySeconds, TimedActionCallback callback = nullptr);
+  void pwmSetTime(int pinNum, int pwmValue, unsigned long delaySeconds, PinCallback callback = nullptr);
+  void pwmSetTime(PinHandle handle, int pwmValue, unsigned long delaySeconds, PinCallback callback = nullptr);
+
+  /**
+   * @brief Millisecond and microsecond versions of pwmSetTime().
+   * @param delayMs / delayUs The delay before the pin reverts.
+   */
+  void pwmSetTimeMs(int pinNum, int pwmValue, unsigned long delayMs, PinCallback callback = nullptr);
+  void pwmSetTimeMs(PinHandle handle, int pwmValue, unsigned long delayMs, PinCallback callback = nullptr);
+  void pwmSetTimeUs(int pinNum, int pwmValue, uint64_t delayUs, PinCallback callback = nullptr);
+  void pwmSetTimeUs(PinHandle handle, int pwmValue, uint64_t delayUs, PinCallback callback = nullptr);
 
   /**
    * @brief Fade a pin's PWM value from a start value to a finish value.
    * @param pinNum The pin number to fade.
-   * @param beginPwmValue The starting PWM duty cycle (0-255).
-   * @param finishPwmValue The ending PWM duty cycle (0-255).
+   * @param beginPwmValue The starting PWM duty cycle (0 to pwmMaxValue()).
+   * @param finishPwmValue The ending PWM duty cycle (0 to pwmMaxValue()).
    */
   void pwmFade(int pinNum, int beginPwmValue, int finishPwmValue);
+  void pwmFade(PinHandle handle, int beginPwmValue, int finishPwmValue);
+
+  /**
+   * @brief Fade a pin's PWM value over a given duration, with an optional easing curve.
+   * @param pinNum The pin number to fade.
+   * @param beginPwmValue The starting PWM duty cycle (0 to pwmMaxValue()).
+   * @param finishPwmValue The ending PWM duty cycle (0 to pwmMaxValue()).
+   * @param fadeDurationMs The duration of the fade in milliseconds.
+   * @param curve (Optional) The easing curve, FADE_LINEAR by default.
+   */
+  void pwmFade(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long fadeDurationMs, FadeCurve curve = FADE_LINEAR);
+  void pwmFade(PinHandle handle, int beginPwmValue, int finishPwmValue, unsigned long fadeDurationMs, FadeCurve curve = FADE_LINEAR);
 
   /**
    * @brief Fade a pin's PWM value over a specified duration.
    * @param pinNum The pin number to fade.
-   * @param beginPwmValue The starting PWM duty cycle (0-255).
-   * @param finishPwmValue The ending PWM duty cycle (0-255).
+   * @param beginPwmValue The starting PWM duty cycle (0 to pwmMaxValue()).
+   * @param finishPwmValue The ending PWM duty cycle (0 to pwmMaxValue()).
    * @param holdTimeSeconds The duration to hold the start value before fading (in seconds).
    * @param callback (Optional) A function to call when the fade is complete.
    */
-  void pwmFadeTime(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds, TimedActionCallback callback = nullptr);
+  void pwmFadeTime(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds, PinCallback callback = nullptr);
+  void pwmFadeTime(PinHandle handle, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds, PinCallback callback = nullptr);
+
+  /**
+   * @brief Hold a PWM value, then fade over a given duration with an optional easing curve.
+   * @param pinNum The pin number to fade.
+   * @param beginPwmValue The starting PWM duty cycle (0 to pwmMaxValue()).
+   * @param finishPwmValue The ending PWM duty cycle (0 to pwmMaxValue()).
+   * @param holdTimeSeconds The duration to hold the start value before fading (in seconds).
+   * @param fadeDurationMs The duration of the fade itself in milliseconds.
+   * @param curve (Optional) The easing curve, FADE_LINEAR by default.
+   * @param callback (Optional) A function to call when the fade is complete.
+   */
+  void pwmFadeTime(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds,
+                   unsigned long fadeDurationMs, FadeCurve curve = FADE_LINEAR, PinCallback callback = nullptr);
+  void pwmFadeTime(PinHandle handle, int beginPwmValue, int finishPwmValue, unsigned long holdTimeSeconds,
+                   unsigned long fadeDurationMs, FadeCurve curve = FADE_LINEAR, PinCallback callback = nullptr);
+
+  /**
+   * @brief Millisecond and microsecond versions of pwmFadeTime(); both the hold and the fade use the unit.
+   *        Fades shorter than a millisecond always use the software ramp.
+   * @param holdMs / holdUs The duration to hold the start value before fading.
+   * @param fadeDurationMs / fadeDurationUs The duration of the fade itself.
+   */
+  void pwmFadeTimeMs(int pinNum, int beginPwmValue, int finishPwmValue, unsigned long holdMs,
+                     unsigned long fadeDurationMs, FadeCurve curve = FADE_LINEAR, PinCallback callback = nullptr);
+  void pwmFadeTimeMs(PinHandle handle, int beginPwmValue, int finishPwmValue, unsigned long holdMs,
+                     unsigned long fadeDurationMs, FadeCurve curve = FADE_LINEAR, PinCallback callback = nullptr);
+  void pwmFadeTimeUs(int pinNum, int beginPwmValue, int finishPwmValue, uint64_t holdUs,
+                     uint64_t fadeDurationUs, FadeCurve curve = FADE_LINEAR, PinCallback callback = nullptr);
+  void pwmFadeTimeUs(PinHandle handle, int beginPwmValue, int finishPwmValue, uint64_t holdUs,
+                     uint64_t fadeDurationUs, FadeCurve curve = FADE_LINEAR, PinCallback callback = nullptr);
+
+  /**
+   * @brief Run a sequence of PWM keyframes on a pin, entirely from update().
+   *        Each keyframe either fades from the previous value to its own along a FadeCurve,
+   *        or jumps to its value and holds it (KEYFRAME_STEP). The first keyframe starts from
+   *        the pin's current PWM value. Steps are timed from the previous step's planned end,
+   *        so a looping sequence does not drift. Any other set, timed or fade call on the pin
+   *        stops the sequence.
+   * @param pinNum The pin number to run the sequence on.
+   * @param keyframes The keyframes. The array is not copied and must outlive the sequence.
+   * @param keyframeCount The number of keyframes.
+   * @param repeatCount (Optional) How many times to run through the keyframes, 0 (default) to loop forever.
+   * @param callback (Optional) A function to call when a finite sequence is complete.
+   */
+  void pwmSequence(int pinNum, const PinKeyframe* keyframes, uint8_t keyframeCount, uint16_t repeatCount = 0,
+                   PinCallback callback = nullptr);
+  void pwmSequence(PinHandle handle, const PinKeyframe* keyframes, uint8_t keyframeCount, uint16_t repeatCount = 0,
+                   PinCallback callback = nullptr);
+
+  /**
+   * @brief Let the ESP32 LEDC peripheral run fades instead of update().
+   *        When enabled, pwmFade() and pwmFadeTime() program the hardware fade engine
+   *        and update() only finishes the action once the fade-end interrupt has fired.
+   *        Requires the Arduino-ESP32 3.x core.
+   * @param enabled True to use hardware fades, false for the software ramp (default).
+   * @return True if the requested mode is available on this build.
+   */
+  bool setHardwareFade(bool enabled);
+
+  // --- Output Drivers ---
+  /**
+   * @brief Drive a range of virtual pins through an external device, e.g. a PCA9685 or MCP23017
+   *        (see AvantPinSetExpanders.h). Virtual pins are listed in the constructor like GPIOs and get
+   *        the same API, including timers, fades, sequences and groups; the device's channel n is
+   *        pin firstPin + n. Their writes are collected while a method or update() runs and sent
+   *        with one flush() per device at the end of it. Pulses on virtual pins are timed by
+   *        update(), and their fades always use the software ramp.
+   *        PWM values keep the pin's resolution and are scaled to the device's.
+   *        The driver's begin() is called here, so start the bus first. The pins are then set up
+   *        as outputs with their current state.
+   * @param driver The driver; it has to stay alive as long as this instance.
+   * @param firstPin The pin number of channel 0, from AVANT_PINSET_VIRTUAL_PIN_BASE.
+   * @return False if the pins are outside the virtual range or overlap another driver,
+   *         AVANT_PINSET_MAX_DRIVERS are attached, or the device did not answer.
+   */
+  bool attachDriver(PinOutputDriver& driver, int firstPin);
+
+  // --- Pin Groups ---
+  /**
+   * @brief Define a named group of pins that fade together, e.g. the channels of an RGB(W) fixture.
+   *        A pin may belong to several groups.
+   * @param name The group name, copied (truncated to AVANT_PINSET_GROUP_NAME_LENGTH - 1 characters).
+   * @param pinList The member pins, in the order the value arrays of groupFade() use.
+   * @param count The number of pins, 1 to AVANT_PINSET_GROUP_SIZE.
+   * @return The group id, or -1 if a pin is not managed or listed twice, the name is taken, or AVANT_PINSET_MAX_GROUPS are defined.
+   */
+  int addGroup(const char* name, const int pinList[], uint8_t count);
+
+  /**
+   * @brief Look up a group by name.
+   * @param name The name given to addGroup().
+   * @return The group id, or -1 if there is no such group.
+   */
+  int groupId(const char* name) const;
+
+  /**
+   * @brief Fade all pins of a group at once. The members share one timer and one progress value,
+   *        which is computed (and eased) once per tick, so the channels stay phase-locked.
+   *        Any other set, timed or fade call on a member takes it out of the group fade; on the first
+   *        member, which carries the group's timer, it stops the others at the value they reached.
+   *        Group fades always use the software ramp.
+   * @param groupId The id returned by addGroup() (or the group name).
+   * @param fromValues Start values, one per member, or nullptr to start from the current values.
+   * @param toValues Finish values, one per member.
+   * @param durationMs The duration of the fade in milliseconds.
+   * @param callback (Optional) A function called once, with the first member's pin number, when the fade is complete.
+   * @param curve (Optional) The easing curve, FADE_LINEAR by default.
+   * @return True if the fade was started.
+   */
+  bool groupFade(int groupId, const int fromValues[], const int toValues[], unsigned long durationMs,
+                 PinCallback callback = nullptr, FadeCurve curve = FADE_LINEAR);
+  bool groupFade(const char* name, const int fromValues[], const int toValues[], unsigned long durationMs,
+                 PinCallback callback = nullptr, FadeCurve curve = FADE_LINEAR);
+
+  // --- Command Queue ---
+  /**
+   * @brief Queue a command to be applied by the next update() (or by the scheduler task).
+   *        Never blocks and takes no lock, so it is safe to call from any task or from an ISR,
+   *        for example from a web server or MQTT callback running on the other core.
+   *        Timed commands queued this way have no completion callback.
+   * @param command The command to queue.
+   * @return True if the command was queued, false if the queue is full.
+   */
+  bool postCommand(const PinCommand& command);
+
+  // --- Action Queues ---
+  /**
+   * @brief Queue a command on its pin, to start when the pin's current timed action (timer, fade,
+   *        sequence or pulse) completes. Queued actions run in order, each after the previous one
+   *        completes; untimed commands complete at once. On an idle pin the command starts right away.
+   *        Calling the pin methods directly (digitalSet(), pwmFade(), ...) replaces the current action
+   *        and drops the queue, as does a command posted with postCommand().
+   * @param command The command to queue; its pinNumber selects the queue.
+   * @param callback Optional function called when this action completes.
+   * @param mode QUEUE_APPEND, QUEUE_REPLACE_PENDING or QUEUE_REPLACE_ALL.
+   * @return False if the pin is not managed, the command type is unknown, the pin already has
+   *         AVANT_PINSET_PIN_QUEUE_DEPTH actions waiting, or the shared pool is exhausted.
+   */
+  bool queueAction(const PinCommand& command, PinCallback callback = nullptr, PinQueueMode mode = QUEUE_APPEND);
+
+  /**
+   * @brief Get the number of actions waiting on a pin behind its current action.
+   * @param pinNum The pin number (or a handle from getHandle()).
+   * @return The number of waiting actions, 0 for unmanaged pins.
+   */
+  uint8_t queuedActions(int pinNum) const;
+  uint8_t queuedActions(PinHandle handle) const;
+
+  /**
+   * @brief Drop the actions waiting on a pin. The current action runs on to completion.
+   *        Callbacks of the dropped actions are not called.
+   * @param pinNum The pin number (or a handle from getHandle()).
+   * @return The number of actions dropped.
+   */
+  uint8_t cancelQueuedActions(int pinNum);
+  uint8_t cancelQueuedActions(PinHandle handle);
+
+#if AVANT_PINSET_HAS_FREERTOS
+  // --- Completion Events ---
+  /**
+   * @brief Post a PinEvent to a FreeRTOS queue for every action that completes, so the work that
+   *        follows a completion (e.g. publishing over MQTT) runs in the consumer's own task instead of
+   *        in a callback inside update(). Events are posted without blocking; when the queue is full
+   *        the event is dropped and counted in stats().eventsDropped. Completion callbacks still run
+   *        if they are given, so leave them out to keep update() short.
+   * @param queue A queue created with xQueueCreate(length, sizeof(PinEvent)), or nullptr to stop posting.
+   */
+  void setEventQueue(QueueHandle_t queue);
+#endif
 
   // --- Status Methods ---
   /**
@@ -113,16 +862,425 @@ public:
    *         Example (PWM): {"mode":"PWM","value":"88"}
    */
   String pinStatus(int pinNum);
+  String pinStatus(PinHandle handle);
+
+  /**
+   * @brief Write the status of all managed pins into a caller-supplied buffer, without heap allocation.
+   *        The output is byte-identical to systemStatus().
+   * @param buffer The buffer to write the NUL-terminated JSON into (may be nullptr if bufferSize is 0).
+   * @param bufferSize The size of the buffer in bytes.
+   * @return The length of the full JSON text, excluding the terminator. If this is greater than or
+   *         equal to bufferSize, the output was truncated (like snprintf()).
+   */
+  size_t systemStatus(char* buffer, size_t bufferSize);
+
+  /**
+   * @brief Write the detailed status of a single pin into a caller-supplied buffer, without heap allocation.
+   *        The output is byte-identical to pinStatus(pinNum).
+   * @param pinNum The pin number to query.
+   * @param buffer The buffer to write the NUL-terminated JSON into (may be nullptr if bufferSize is 0).
+   * @param bufferSize The size of the buffer in bytes.
+   * @return The length of the full JSON text, excluding the terminator (see systemStatus(char*, size_t)).
+   */
+  size_t pinStatus(int pinNum, char* buffer, size_t bufferSize);
+  size_t pinStatus(PinHandle handle, char* buffer, size_t bufferSize);
+
+  /**
+   * @brief Check whether any pin changed since the last statusDelta() call.
+   * @return True if statusDelta() would report at least one pin.
+   */
+  bool hasChanges() const;
+
+  /**
+   * @brief Get the status of the pins that changed since the last call, then clear the change set.
+   *        Pins are marked as changed by the set, timed and fade methods and when a timer or fade completes.
+   * @return A String in the same format as systemStatus(), containing only the changed pins.
+   *         Example: {"6":"88"}, or {} if nothing changed.
+   */
+  String statusDelta();
+
+  /**
+   * @brief Allocation-free version of statusDelta(), writing into a caller-supplied buffer.
+   *        The change set is only cleared if the output fit into the buffer.
+   * @param buffer The buffer to write the NUL-terminated JSON into.
+   * @param bufferSize The size of the buffer in bytes.
+   * @return The length of the full JSON text, excluding the terminator (see systemStatus(char*, size_t)).
+   */
+  size_t statusDelta(char* buffer, size_t bufferSize);
+
+  /**
+   * @brief Write the status of all managed pins in binary: a pin count byte, then
+   *        PIN_PACKED_STATUS_SIZE bytes per pin (pin number, PinModeState, value little-endian).
+   *        Pins running a sequence report PIN_MODE_SEQUENCE, and holds report PIN_MODE_FADING.
+   * @param buffer The buffer to write into.
+   * @param bufferSize The size of the buffer in bytes.
+   * @return The length of the packed status. If this is greater than bufferSize, nothing was written.
+   */
+  size_t packedStatus(uint8_t* buffer, size_t bufferSize);
+
+  /**
+   * @brief Binary version of statusDelta(), in the format of packedStatus().
+   *        The change set is only cleared if the output fit into the buffer.
+   * @param buffer The buffer to write into.
+   * @param bufferSize The size of the buffer in bytes.
+   * @return The length of the packed status (see packedStatus()).
+   */
+  size_t packedStatusDelta(uint8_t* buffer, size_t bufferSize);
+
+  // --- Runtime Statistics ---
+  /**
+   * @brief Get the runtime counters of this instance, e.g. to flag devices whose timing slips.
+   *        A growing maxLatenessMicros means update() is not called often enough.
+   * @return A copy of the counters since construction or the last resetStats().
+   */
+  PinSetStats stats() const;
+
+  /**
+   * @brief Get the runtime counters as a JSON string.
+   * @return Example: {"updateCalls":1200,"actionsFired":3,"callbacksRun":2,"maxLatenessMicros":1200,"maxUpdateMicros":85,"eventsDropped":0}
+   */
+  String statsJson() const;
+
+  /**
+   * @brief Allocation-free version of statsJson(), writing into a caller-supplied buffer.
+   * @param buffer The buffer to write the NUL-terminated JSON into.
+   * @param bufferSize The size of the buffer in bytes.
+   * @return The length of the full JSON text, excluding the terminator (see systemStatus(char*, size_t)).
+   */
+  size_t statsJson(char* buffer, size_t bufferSize) const;
+
+  /**
+   * @brief Clear all runtime counters.
+   */
+  void resetStats();
+
+  // --- Wall-Clock Rules ---
+  /**
+   * @brief Add a rule that applies a command at a local time of day, or relative to sunrise or sunset,
+   *        on selected days. Rules use the system clock (time(), e.g. set by configTime() from NTP)
+   *        and its TZ setting, and only fire once the clock has been set.
+   *        Rules share the deadline scheduler with the timers, so update() only checks them when the
+   *        next one is due (or every AVANT_PINSET_RULE_RECHECK_MS, to follow clock corrections).
+   * @param rule The rule to add. Example: {{PIN_CMD_DIGITAL_SET, 2, HIGH, 0, 0}, RULE_WEEKDAYS, RULE_AT_TIME, 7 * 60 + 30}
+   * @return An id for removeRule(), or -1 if the rule is invalid or AVANT_PINSET_MAX_RULES are in use.
+   */
+  int addRule(const PinRule& rule);
+
+  /**
+   * @brief Remove a rule added with addRule().
+   * @param ruleId The id returned by addRule().
+   * @return True if the rule existed.
+   */
+  bool removeRule(int ruleId);
+
+  /**
+   * @brief Remove all rules.
+   */
+  void clearRules();
+
+  /**
+   * @brief Set the location used for RULE_AT_SUNRISE and RULE_AT_SUNSET rules.
+   *        Sun rules do not fire until a location is set, nor on days without sunrise or sunset.
+   * @param latitude Degrees north, negative for south.
+   * @param longitude Degrees east, negative for west.
+   */
+  void setLocation(float latitude, float longitude);
+
+  /**
+   * @brief Get the wall-clock time at which the next rule fires.
+   * @return The time as returned by time(), or 0 if no rule is scheduled (or the clock is not set).
+   */
+  time_t nextRuleTime() const;
+
+  // --- Snapshots ---
+  /**
+   * @brief Write a compact binary snapshot of every pin's mode, value and remaining timer time.
+   *        Fades are saved at the value they have reached, sequences as their current PWM value,
+   *        and pulses as their idle level. Callbacks cannot be saved.
+   * @param buffer The buffer to write the snapshot into
+   * @param bufferSize The size of the buffer in bytes.
+   * @return The length of the snapshot in bytes. If this is greater than bufferSize, nothing was written.
+   */
+  size_t writeSnapshot(uint8_t* buffer, size_t bufferSize) const;
+
+  /**
+   * @brief Apply a snapshot written by writeSnapshot(), e.g. one kept by the application itself.
+   *        Pins are matched by number; pins missing from the snapshot are left alone.
+   *        Restored timers and fades continue with the time they had left and have no callback.
+   * @param snapshot The snapshot bytes.
+   * @param length The length of the snapshot in bytes.
+   * @return True if the snapshot was valid and applied.
+   */
+  bool restoreSnapshot(const uint8_t* snapshot, size_t length);
+
+  /**
+   * @brief Write the snapshot to the store chosen in the constructor right away, without waiting
+   *        for update() to coalesce the write. Call it before a planned restart, e.g. an OTA update.
+   * @return True if the snapshot was stored.
+   */
+  bool flushSnapshot();
+
+  /**
+   * @brief Remove the stored snapshot, so the next boot starts every pin LOW.
+   *        Snapshots are taken again by update() once a pin changes.
+   */
+  void clearSnapshot();
+
+  // --- Profiling ---
+  /**
+   * @brief Check whether the library was built with AVANT_PINSET_PROFILING.
+   *        The define must reach the library sources, e.g. through the build flags
+   *        (-DAVANT_PINSET_PROFILING); defining it in the sketch only is not enough.
+   * @return True if the profiled paths are being timed.
+   */
+  static bool profilingEnabled();
+
+  /**
+   * @brief Get the timing collected for a code path, summed over all instances.
+   *        Timed with the ESP32 cycle counter, so it adds a few cycles per profiled call.
+   * @param path The code path to query.
+   * @return The call count and min/max/total cycles; all zero if profiling is disabled.
+   */
+  static PinSetProfile profile(PinSetProfilePath path);
+
+  /**
+   * @brief Clear the timing collected for all code paths.
+   */
+  static void resetProfile();
+
+protected:
+  /**
+   * @brief Construct on caller-supplied storage instead of the heap (used by AvantPinSetStatic).
+   * @param pinStorage Array of at least min(numPins, AVANT_PINSET_MAX_PINS) entries for the pin table.
+   * @param timerStorage Array of the same length for the timer heap.
+   * @param slotStorage Array of the same length for the pins' timer heap positions.
+   */
+  AvantPinSet(const int pinList[], int numPins, uint32_t pwmFrequency, uint8_t pwmResolution, PinSnapshotMode snapshotMode,
+              PinData* pinStorage, PinTimer* timerStorage, int8_t* slotStorage);
 
 private:
-  std::vector<PinData> _pins;
+  PinData* _pins;                          // Managed pins, in pinList order
+  size_t _pinCount;
+  int8_t _pinIndex[AVANT_PINSET_MAX_GPIO + AVANT_PINSET_MAX_VIRTUAL_PINS]; // pinSlot() -> index into _pins, -1 if unmanaged
+  PinTimer* _timerHeap;                    // Min-heap of pending timers ordered by deadline
+  size_t _timerCount;
+  int8_t* _timerSlot;                      // Pin index -> position in _timerHeap, -1 if no timer is pending
+  bool _ownsStorage;                       // The arrays above were allocated by the constructor
+  bool _hardwareFade = false;              // Run fades on the LEDC peripheral
+  uint64_t _dirtyMask;                     // Bit per pin index, set when the reported status changes
+  PinSetStats _stats;                      // Runtime counters reported by stats()
+  PinSnapshotMode _snapshotMode;           // Where the snapshot is kept, SNAPSHOT_OFF for none
+  bool _snapshotChanged = false;           // A pin changed since the snapshot was last taken
+  bool _snapshotNvsPending = false;        // The NVS copy is out of date
+  uint32_t _pinListHash = 0;               // Identifies the stored snapshot of this pin list
+  uint32_t _snapshotNvsHash = 0;           // Checksum of the snapshot last written to NVS
+  uint64_t _snapshotRtcTime = 0;           // Time the RTC snapshot was last taken (microseconds)
+  uint64_t _snapshotNvsDue = 0;            // Earliest time the next NVS write may happen (microseconds)
+
+  PinRule _rules[AVANT_PINSET_MAX_RULES];  // Rule slots, indexed by rule id
+  int64_t _ruleNext[AVANT_PINSET_MAX_RULES]; // Wall-clock time each rule fires next, 0 if not scheduled
+  uint8_t _ruleOrder[AVANT_PINSET_MAX_RULES]; // Ids of the rules in use, by next fire time
+  uint8_t _ruleCount = 0;
+  uint32_t _ruleSlots = 0;                 // Bit per rule id in use
+  uint64_t _ruleDeadline = 0;              // Time update() next checks the rules (microseconds)
+  bool _locationSet = false;
+  float _latitude = 0;
+  float _longitude = 0;
+
+  PinGroup _groups[AVANT_PINSET_MAX_GROUPS];
+  uint8_t _groupCount = 0;
 
+  // Attached output drivers, flushed when the outermost TaskLock is released
+  PinOutputDriver* _drivers[AVANT_PINSET_MAX_DRIVERS];
+  uint8_t _driverFirstPin[AVANT_PINSET_MAX_DRIVERS];
+  uint8_t _driverCount = 0;
+  mutable uint8_t _lockDepth = 0;
+
+  // Bit per pin with a PWM write held until the outermost TaskLock is released, so a pin
+  // written several times in one operation gets a single write with its final duty
+  uint64_t _pwmPending = 0;
+
+  PinQueuedAction _actionPool[AVANT_PINSET_ACTION_POOL_SIZE]; // Shared by the action queues of all pins
+  uint8_t _actionFree = 0;                 // First unused pool entry, or ACTION_NONE
+
+  // Slot of the bounded multi-producer command queue; seq tells producers and the consumer whose turn it is
+  struct CommandSlot {
+    std::atomic<uint32_t> seq;
+    PinCommand command;
+  };
+  CommandSlot _commandQueue[AVANT_PINSET_QUEUE_SIZE];
+  std::atomic<uint32_t> _commandHead; // Next slot to be claimed by a producer
+  uint32_t _commandTail;              // Next slot to be drained by update()
+
+#if AVANT_PINSET_HAS_FREERTOS
+  TaskHandle_t _taskHandle = nullptr;      // Scheduler task, nullptr when update() is driven by loop()
+  SemaphoreHandle_t _taskLock = nullptr;   // Guards pin state while the scheduler task is running
+  QueueHandle_t _eventQueue = nullptr;     // Receives a PinEvent per completed action, nullptr for none
+#endif
+  uint32_t _serviceLateness = 0;           // Lateness of the timer update() is servicing (microseconds)
+
+  // Holds the task lock for the lifetime of the guard (no-op without a scheduler task)
+  class TaskLock {
+  public:
+    explicit TaskLock(const AvantPinSet* owner);
+    ~TaskLock();
+  private:
+    const AvantPinSet* _owner;
+  };
+
+  // fadeGroup of pins that are not part of a group fade
+  static const uint8_t NO_GROUP = 0xFF;
+
+  // End of an action queue or of the pool's free list
+  static const uint8_t ACTION_NONE = 0xFF;
+
+  // Fade duration used when none is given
+  static const unsigned long DEFAULT_FADE_MS = 1000UL;
+
+  // ledcChannel values for pins without a usable LEDC channel
+  static const int8_t LEDC_DETACHED = -1;    // Attach on the next PWM write
+  static const int8_t LEDC_UNAVAILABLE = -2; // Attaching failed, use analogWrite()
+
+  // Extra time allowed for the fade-end interrupt before a hardware fade is finished anyway
+  static const uint64_t HW_FADE_GRACE_US = 100000ULL;
+
+  // How often a finished hardware fade is checked for its fade-end interrupt
+  static const uint64_t HW_FADE_POLL_US = 1000ULL;
+
+  // How often a pulse train past its planned end is checked for its last edge
+  static const uint64_t PULSE_POLL_US = 100ULL;
+
+  /**
+   * @brief Helper function to get a pin's data from a handle.
+   * @param handle The handle to resolve.
+   * @return A pointer to the PinData struct, or nullptr if the handle is invalid.
+   */
+  PinData* handleData(PinHandle handle);
+
+  /**
+   * @brief Helper function to map a pin's mode to the text used in status reports.
+   * @param pin The pin to describe.
+   * @return "digital", "pwm", "fading", "sequence" or "pulse".
+   */
+  static const char* modeName(const PinData& pin);
+
+  // Number of pin table entries needed for a pin list of the given length
+  static size_t storageSize(int numPins);
+
+  // --- Status helpers ---
+  static const uint64_t ALL_PINS = ~0ULL;
+  void markDirty(size_t index) {
+    _dirtyMask |= 1ULL << index;
+    _snapshotChanged = true;
+  }
+  String buildStatus(uint64_t mask);
+  size_t writeStatus(char* buffer, size_t bufferSize, uint64_t mask);
+  static size_t writePinStatus(const PinData* pin, char* buffer, size_t bufferSize);
+  size_t writePackedStatus(uint8_t* buffer, size_t bufferSize, uint64_t mask);
+
+  // --- Command queue helpers ---
+  void drainCommands();
+  void applyCommand(const PinCommand& command);
+
+  // --- Action queue helpers ---
+  void startAction(uint8_t index, const PinCommand& command, PinCallback callback);
+  void runQueuedActions(uint8_t index);
+  uint8_t dropQueuedActions(PinData& pin);
+  void completeAction(uint8_t index, PinEventType type);
+
+  // --- Group helpers ---
+  void runGroupFade(uint8_t index, uint64_t currentMicros);
+  void leaveGroupFade(PinData& pin);
+  static uint32_t groupProgress(const PinData& pin, uint64_t now);
+  static uint32_t easeProgress(FadeCurve curve, uint32_t progress, bool falling);
+  static int groupFadeValue(const PinData& pin, uint32_t eased);
+
+  // --- Batch helpers ---
+  void claimDigital(uint8_t index, int state);
+  static void writeDigitalMasks(uint64_t setMask, uint64_t clearMask);
+
+  // --- PWM helpers ---
+  static uint8_t validResolution(uint8_t resolutionBits);
+  static int maxDuty(const PinData& pin) { return (1 << pin.pwmResolution) - 1; }
+  void writePwm(PinData& pin, int value);
+  void outputPwm(PinData& pin, int value);
+  void writePendingPwm();
+  void forgetPwm(PinData& pin);
+  void attachLedc(PinData& pin);
+  void setDigitalOutput(PinData& pin);
+
+  // --- Driver helpers ---
+  static int pinSlot(int pinNum);
+  static bool isVirtual(const PinData& pin) { return pin.pinNumber >= AVANT_PINSET_VIRTUAL_PIN_BASE; }
+  static void writeDigital(const PinData& pin, int level);
+  void flushDrivers() const;
+
+  // --- Rule helpers ---
+  void runRules(uint64_t now);
+  void sortRules();
+  int64_t nextOccurrence(const PinRule& rule, int64_t after) const;
+  void requestRuleCheck();
+
+  // --- Snapshot helpers ---
+  void restorePin(uint8_t index, const uint8_t* entry, bool startup);
+  static int fadePosition(const PinData& pin, uint64_t now);
+  void serviceSnapshot(uint64_t now);
+  uint64_t snapshotDeadline() const;
+  bool storeSnapshot(uint64_t now, bool toNvs);
+
+  // --- Scheduler helpers ---
+  void runTimer(uint8_t index, uint64_t currentMicros);
+  void stopAction(PinData& pin);
+  void runSequenceStep(uint8_t index, uint64_t stepStart);
+  void beginFade(uint8_t index, uint64_t currentMicros);
+  static uint32_t fadeDistance(const PinData& pin);
+  static int fadeValue(const PinData& pin);
+  static const uint16_t* curveTable(FadeCurve curve);
+  void stopHardwareFade(PinData& pin);
+  static void onHardwareFadeDone(void* arg);
+  bool outputsSteady() const;
+  void holdOutputs(bool hold) const;
+  void fireCallback(PinData& pin);
+  static bool advancePulse(PinData& pin);
+  static void writePulseOutput(const PinData& pin);
+  void stopPulse(PinData& pin);
+  static void onPulseEdge(void* arg);
+  static void taskEntry(void* arg);
+  void scheduleTimer(uint8_t index, uint64_t deadline);
+  void cancelTimer(uint8_t index);
+  bool timerBefore(int slotA, int slotB) const;
+  void swapTimers(int slotA, int slotB);
+  void siftUp(int slot);
+  void siftDown(int slot);
+};
+
+// Storage of an AvantPinSetStatic, a separate base so it is constructed before AvantPinSet uses it
+template <size_t N>
+struct AvantPinSetStorage {
+  std::array<PinData, N> pinStorage;
+  std::array<PinTimer, N> timerStorage;
+  std::array<int8_t, N> slotStorage;
+};
+
+// AvantPinSet for a pin list known at compile time: the pin table and timer heap live inside
+// the object (in static memory for a global instance), so it never touches the heap.
+template <size_t N>
+class AvantPinSetStatic : private AvantPinSetStorage<N>, public AvantPinSet {
+  static_assert(N > 0 && N <= AVANT_PINSET_MAX_PINS, "AvantPinSetStatic supports 1 to AVANT_PINSET_MAX_PINS pins");
+
+public:
   /**
-   * @brief Helper function to find a pin's data in the vector.
-   * @param pinNum The pin number to find.
-   * @return A pointer to the PinData struct, or nullptr if not found.
+   * @brief Construct a new AvantPinSetStatic object. The API is the same as AvantPinSet's.
+   * @param pinList An array of exactly N pin numbers, e.g. AvantPinSetStatic<3> pins({2, 4, 27});
+   * @param pwmFrequency (Optional) The PWM frequency in Hz for all pins.
+   * @param pwmResolution (Optional) The PWM resolution in bits for all pins (1-16).
+   * @param snapshotMode (Optional) Where to keep the pin snapshot restored at startup.
    */
-  PinData* findPinData(int pinNum);
+  explicit AvantPinSetStatic(const int (&pinList)[N], uint32_t pwmFrequency = AVANT_PINSET_PWM_FREQUENCY,
+                             uint8_t pwmResolution = AVANT_PINSET_PWM_RESOLUTION, PinSnapshotMode snapshotMode = SNAPSHOT_OFF)
+      : AvantPinSet(pinList, (int)N, pwmFrequency, pwmResolution, snapshotMode,
+                    AvantPinSetStorage<N>::pinStorage.data(), AvantPinSetStorage<N>::timerStorage.data(),
+                    AvantPinSetStorage<N>::slotStorage.data()) {}
 };
 
 #endif // AVANT_PIN_SET_H
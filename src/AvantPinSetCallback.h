@@ -0,0 +1,160 @@
+/*
+  AvantPinSetCallback.h - Fixed-size completion callback for the AvantPinSet library.
+*/
+
+#ifndef AVANT_PIN_SET_CALLBACK_H
+#define AVANT_PIN_SET_CALLBACK_H
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+// Bytes available for a callable stored in a PinCallback (a lambda's captures, or a function pointer and context)
+#ifndef AVANT_PINSET_CALLBACK_SIZE
+#define AVANT_PINSET_CALLBACK_SIZE (2 * sizeof(void*))
+#endif
+
+// Callback type of earlier versions, still accepted wherever a PinCallback is expected
+typedef std::function<void(int pinNum)> TimedActionCallback;
+
+// Completion callback that stores its callable inline and never allocates.
+// Accepts plain functions, lambdas whose captures fit in AVANT_PINSET_CALLBACK_SIZE bytes,
+// and a function pointer with a void* context. A TimedActionCallback (std::function) is
+// also accepted as an opt-in; it is copied to the heap, since it does not fit inline.
+class PinCallback {
+public:
+  PinCallback() : _ops(nullptr) {}
+  PinCallback(std::nullptr_t) : _ops(nullptr) {}
+
+  // Any callable taking the pin number, stored inline
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, PinCallback>::value &&
+                                               !std::is_same<typename std::decay<F>::type, TimedActionCallback>::value>::type,
+            typename = decltype(std::declval<typename std::decay<F>::type&>()(0))>
+  PinCallback(F&& callable) : _ops(nullptr) {
+    emplace<typename std::decay<F>::type>(std::forward<F>(callable));
+  }
+
+  // A plain function; a null pointer gives an empty callback, as it did with std::function
+  PinCallback(void (*function)(int pinNum)) : _ops(nullptr) {
+    if (function) emplace<void (*)(int)>(function);
+  }
+
+  // A function pointer called with a user-supplied context, e.g. an object pointer
+  PinCallback(void (*function)(void* context, int pinNum), void* context) : _ops(nullptr) {
+    if (function) emplace<ContextFunction>(ContextFunction{function, context});
+  }
+
+  // Opt-in for std::function, which may need more space than the inline buffer
+  PinCallback(const TimedActionCallback& callback) : _ops(nullptr) {
+    if (callback) emplace<BoxedFunction>(BoxedFunction(callback));
+  }
+
+  PinCallback(const PinCallback& other) : _ops(other._ops) {
+    if (_ops) _ops(OP_COPY, _storage, other._storage, 0);
+  }
+
+  PinCallback(PinCallback&& other) : _ops(other._ops) {
+    if (_ops) _ops(OP_MOVE, _storage, other._storage, 0);
+    other._ops = nullptr;
+  }
+
+  PinCallback& operator=(const PinCallback& other) {
+    if (this != &other) {
+      reset();
+      _ops = other._ops;
+      if (_ops) _ops(OP_COPY, _storage, other._storage, 0);
+    }
+    return *this;
+  }
+
+  PinCallback& operator=(PinCallback&& other) {
+    if (this != &other) {
+      reset();
+      _ops = other._ops;
+      if (_ops) _ops(OP_MOVE, _storage, other._storage, 0);
+      other._ops = nullptr;
+    }
+    return *this;
+  }
+
+  PinCallback& operator=(std::nullptr_t) {
+    reset();
+    return *this;
+  }
+
+  ~PinCallback() { reset(); }
+
+  explicit operator bool() const { return _ops != nullptr; }
+
+  void operator()(int pinNum) const {
+    if (_ops) _ops(OP_INVOKE, const_cast<unsigned char*>(_storage), nullptr, pinNum);
+  }
+
+private:
+  enum Operation { OP_INVOKE, OP_COPY, OP_MOVE, OP_DESTROY };
+
+  // One function per stored type handles calling, copying, moving and destroying it
+  typedef void (*Operations)(Operation op, void* storage, const void* source, int pinNum);
+
+  struct ContextFunction {
+    void (*function)(void* context, int pinNum);
+    void* context;
+    void operator()(int pinNum) const { function(context, pinNum); }
+  };
+
+  // Owns a heap copy of a std::function, so only the pointer has to fit inline
+  class BoxedFunction {
+  public:
+    explicit BoxedFunction(const TimedActionCallback& callback) : _function(new TimedActionCallback(callback)) {}
+    BoxedFunction(const BoxedFunction& other) : _function(new TimedActionCallback(*other._function)) {}
+    BoxedFunction(BoxedFunction&& other) : _function(other._function) { other._function = nullptr; }
+    BoxedFunction& operator=(const BoxedFunction&) = delete;
+    ~BoxedFunction() { delete _function; }
+    void operator()(int pinNum) const { (*_function)(pinNum); }
+  private:
+    TimedActionCallback* _function;
+  };
+
+  template <typename T, typename Arg>
+  void emplace(Arg&& callable) {
+    static_assert(sizeof(T) <= AVANT_PINSET_CALLBACK_SIZE,
+                  "Callback captures too much state for PinCallback; capture less, raise AVANT_PINSET_CALLBACK_SIZE, or pass a TimedActionCallback");
+    static_assert(alignof(T) <= alignof(void*), "Callback is over-aligned for PinCallback");
+    new (_storage) T(std::forward<Arg>(callable));
+    _ops = &operations<T>;
+  }
+
+  template <typename T>
+  static void operations(Operation op, void* storage, const void* source, int pinNum) {
+    switch (op) {
+      case OP_INVOKE:
+        (*static_cast<T*>(storage))(pinNum);
+        break;
+      case OP_COPY:
+        new (storage) T(*static_cast<const T*>(source));
+        break;
+      case OP_MOVE: {
+        T* from = static_cast<T*>(const_cast<void*>(source));
+        new (storage) T(std::move(*from));
+        from->~T();
+        break;
+      }
+      case OP_DESTROY:
+        static_cast<T*>(storage)->~T();
+        break;
+    }
+  }
+
+  void reset() {
+    if (_ops) _ops(OP_DESTROY, _storage, nullptr, 0);
+    _ops = nullptr;
+  }
+
+  alignas(void*) unsigned char _storage[AVANT_PINSET_CALLBACK_SIZE];
+  Operations _ops; // nullptr when empty
+};
+
+#endif // AVANT_PIN_SET_CALLBACK_H
@@ -0,0 +1,145 @@
+/*
+  AvantPinSetCurves.h - Precomputed easing curves for AvantPinSet fades.
+
+  Each table maps fade progress (index 0-255) to eased progress (0-65535).
+  The fade engine interpolates between neighbouring entries, so a tick costs
+  a table lookup instead of pow() math. Regenerate with the formulas noted
+  above each table if the curves ever change.
+*/
+
+#ifndef AVANT_PIN_SET_CURVES_H
+#define AVANT_PIN_SET_CURVES_H
+
+#include <stdint.h>
+
+// FADE_GAMMA: x^2.2, compensates for the eye's non-linear response to LED brightness
+static constexpr uint16_t FADE_TABLE_GAMMA[256] = {
+      0,     0,     2,     4,     7,    11,    17,    24,    32,    42,    53,    65,
+     79,    94,   111,   129,   148,   169,   192,   216,   242,   270,   299,   330,
+    362,   396,   432,   469,   508,   549,   591,   635,   681,   729,   779,   830,
+    883,   938,   995,  1053,  1113,  1175,  1239,  1305,  1373,  1443,  1514,  1587,
+   1663,  1740,  1819,  1900,  1983,  2068,  2155,  2243,  2334,  2427,  2521,  2618,
+   2717,  2817,  2920,  3024,  3131,  3240,  3350,  3463,  3578,  3694,  3813,  3934,
+   4057,  4182,  4309,  4438,  4570,  4703,  4838,  4976,  5115,  5257,  5401,  5547,
+   5695,  5845,  5998,  6152,  6309,  6468,  6629,  6792,  6957,  7124,  7294,  7466,
+   7640,  7816,  7994,  8175,  8358,  8543,  8730,  8919,  9111,  9305,  9501,  9699,
+   9900, 10102, 10307, 10515, 10724, 10936, 11150, 11366, 11585, 11806, 12029, 12254,
+  12482, 12712, 12944, 13179, 13416, 13655, 13896, 14140, 14386, 14635, 14885, 15138,
+  15394, 15652, 15912, 16174, 16439, 16706, 16975, 17247, 17521, 17798, 18077, 18358,
+  18642, 18928, 19216, 19507, 19800, 20095, 20393, 20694, 20996, 21301, 21609, 21919,
+  22231, 22546, 22863, 23182, 23504, 23829, 24156, 24485, 24817, 25151, 25487, 25826,
+  26168, 26512, 26858, 27207, 27558, 27912, 28268, 28627, 28988, 29351, 29717, 30086,
+  30457, 30830, 31206, 31585, 31966, 32349, 32735, 33124, 33514, 33908, 34304, 34702,
+  35103, 35507, 35913, 36321, 36732, 37146, 37562, 37981, 38402, 38825, 39252, 39680,
+  40112, 40546, 40982, 41421, 41862, 42306, 42753, 43202, 43654, 44108, 44565, 45025,
+  45487, 45951, 46418, 46888, 47360, 47835, 48313, 48793, 49275, 49761, 50249, 50739,
+  51232, 51728, 52226, 52727, 53230, 53736, 54245, 54756, 55270, 55787, 56306, 56828,
+  57352, 57879, 58409, 58941, 59476, 60014, 60554, 61097, 61642, 62190, 62741, 63295,
+  63851, 64410, 64971, 65535
+};
+
+// FADE_EASE_IN: x^2, starts slowly and accelerates
+static constexpr uint16_t FADE_TABLE_EASE_IN[256] = {
+      0,     1,     4,     9,    16,    25,    36,    49,    65,    82,   101,   122,
+    145,   170,   198,   227,   258,   291,   327,   364,   403,   444,   488,   533,
+    581,   630,   681,   735,   790,   848,   907,   969,  1032,  1098,  1165,  1235,
+   1306,  1380,  1455,  1533,  1613,  1694,  1778,  1864,  1951,  2041,  2133,  2226,
+   2322,  2420,  2520,  2621,  2725,  2831,  2939,  3049,  3161,  3274,  3390,  3508,
+   3628,  3750,  3874,  4000,  4128,  4258,  4390,  4524,  4660,  4798,  4938,  5081,
+   5225,  5371,  5519,  5669,  5821,  5976,  6132,  6290,  6450,  6612,  6777,  6943,
+   7111,  7282,  7454,  7628,  7805,  7983,  8164,  8346,  8530,  8717,  8905,  9096,
+   9288,  9483,  9679,  9878, 10078, 10281, 10486, 10692, 10901, 11111, 11324, 11539,
+  11755, 11974, 12195, 12418, 12642, 12869, 13098, 13329, 13562, 13796, 14033, 14272,
+  14513, 14756, 15001, 15248, 15497, 15748, 16001, 16256, 16513, 16772, 17033, 17296,
+  17561, 17828, 18097, 18368, 18641, 18916, 19193, 19473, 19754, 20037, 20322, 20609,
+  20899, 21190, 21483, 21778, 22076, 22375, 22676, 22980, 23285, 23593, 23902, 24213,
+  24527, 24842, 25160, 25479, 25801, 26124, 26450, 26777, 27107, 27439, 27772, 28108,
+  28445, 28785, 29127, 29470, 29816, 30164, 30513, 30865, 31219, 31575, 31933, 32292,
+  32654, 33018, 33384, 33752, 34122, 34493, 34867, 35243, 35621, 36001, 36383, 36767,
+  37153, 37541, 37931, 38323, 38717, 39113, 39511, 39912, 40314, 40718, 41124, 41532,
+  41942, 42355, 42769, 43185, 43603, 44024, 44446, 44870, 45297, 45725, 46155, 46588,
+  47022, 47458, 47897, 48337, 48780, 49224, 49671, 50119, 50570, 51022, 51477, 51933,
+  52392, 52852, 53315, 53780, 54246, 54715, 55185, 55658, 56133, 56610, 57088, 57569,
+  58052, 58537, 59023, 59512, 60003, 60496, 60991, 61488, 61986, 62487, 62990, 63495,
+  64002, 64511, 65022, 65535
+};
+
+// FADE_EASE_OUT: 1 - (1 - x)^2, starts quickly and decelerates
+static constexpr uint16_t FADE_TABLE_EASE_OUT[256] = {
+      0,   513,  1024,  1533,  2040,  2545,  3048,  3549,  4047,  4544,  5039,  5532,
+   6023,  6512,  6998,  7483,  7966,  8447,  8925,  9402,  9877, 10350, 10820, 11289,
+  11755, 12220, 12683, 13143, 13602, 14058, 14513, 14965, 15416, 15864, 16311, 16755,
+  17198, 17638, 18077, 18513, 18947, 19380, 19810, 20238, 20665, 21089, 21511, 21932,
+  22350, 22766, 23180, 23593, 24003, 24411, 24817, 25221, 25623, 26024, 26422, 26818,
+  27212, 27604, 27994, 28382, 28768, 29152, 29534, 29914, 30292, 30668, 31042, 31413,
+  31783, 32151, 32517, 32881, 33243, 33602, 33960, 34316, 34670, 35022, 35371, 35719,
+  36065, 36408, 36750, 37090, 37427, 37763, 38096, 38428, 38758, 39085, 39411, 39734,
+  40056, 40375, 40693, 41008, 41322, 41633, 41942, 42250, 42555, 42859, 43160, 43459,
+  43757, 44052, 44345, 44636, 44926, 45213, 45498, 45781, 46062, 46342, 46619, 46894,
+  47167, 47438, 47707, 47974, 48239, 48502, 48763, 49022, 49279, 49534, 49787, 50038,
+  50287, 50534, 50779, 51022, 51263, 51502, 51739, 51973, 52206, 52437, 52666, 52893,
+  53117, 53340, 53561, 53780, 53996, 54211, 54424, 54634, 54843, 55049, 55254, 55457,
+  55657, 55856, 56052, 56247, 56439, 56630, 56818, 57005, 57189, 57371, 57552, 57730,
+  57907, 58081, 58253, 58424, 58592, 58758, 58923, 59085, 59245, 59403, 59559, 59714,
+  59866, 60016, 60164, 60310, 60454, 60597, 60737, 60875, 61011, 61145, 61277, 61407,
+  61535, 61661, 61785, 61907, 62027, 62145, 62261, 62374, 62486, 62596, 62704, 62810,
+  62914, 63015, 63115, 63213, 63309, 63402, 63494, 63584, 63671, 63757, 63841, 63922,
+  64002, 64080, 64155, 64229, 64300, 64370, 64437, 64503, 64566, 64628, 64687, 64745,
+  64800, 64854, 64905, 64954, 65002, 65047, 65091, 65132, 65171, 65208, 65244, 65277,
+  65308, 65337, 65365, 65390, 65413, 65434, 65453, 65470, 65486, 65499, 65510, 65519,
+  65526, 65531, 65534, 65535
+};
+
+// FADE_EASE_IN_OUT: 3x^2 - 2x^3 (smoothstep), slow at both ends
+static constexpr uint16_t FADE_TABLE_EASE_IN_OUT[256] = {
+      0,     3,    12,    27,    48,    75,   107,   145,   189,   239,   294,   355,
+    422,   494,   571,   654,   742,   835,   934,  1037,  1146,  1260,  1379,  1503,
+   1632,  1766,  1905,  2049,  2197,  2350,  2508,  2670,  2837,  3009,  3185,  3365,
+   3550,  3739,  3932,  4130,  4332,  4538,  4748,  4962,  5180,  5402,  5628,  5858,
+   6092,  6330,  6571,  6816,  7064,  7316,  7572,  7831,  8094,  8360,  8629,  8901,
+   9177,  9456,  9739, 10024, 10312, 10604, 10898, 11195, 11495, 11798, 12104, 12412,
+  12724, 13037, 13354, 13673, 13994, 14318, 14644, 14973, 15303, 15637, 15972, 16309,
+  16649, 16991, 17334, 17680, 18027, 18377, 18728, 19081, 19436, 19792, 20150, 20510,
+  20871, 21234, 21598, 21964, 22331, 22699, 23068, 23439, 23811, 24184, 24558, 24933,
+  25309, 25686, 26064, 26442, 26822, 27202, 27583, 27964, 28346, 28729, 29112, 29496,
+  29880, 30264, 30649, 31033, 31419, 31804, 32189, 32575, 32960, 33346, 33731, 34116,
+  34502, 34886, 35271, 35655, 36039, 36423, 36806, 37189, 37571, 37952, 38333, 38713,
+  39093, 39471, 39849, 40226, 40602, 40977, 41351, 41724, 42096, 42467, 42836, 43204,
+  43571, 43937, 44301, 44664, 45025, 45385, 45743, 46099, 46454, 46807, 47158, 47508,
+  47855, 48201, 48544, 48886, 49226, 49563, 49898, 50232, 50562, 50891, 51217, 51541,
+  51862, 52181, 52498, 52811, 53123, 53431, 53737, 54040, 54340, 54637, 54931, 55223,
+  55511, 55796, 56079, 56358, 56634, 56906, 57175, 57441, 57704, 57963, 58219, 58471,
+  58719, 58964, 59205, 59443, 59677, 59907, 60133, 60355, 60573, 60787, 60997, 61203,
+  61405, 61603, 61796, 61985, 62170, 62350, 62526, 62698, 62865, 63027, 63185, 63338,
+  63486, 63630, 63769, 63903, 64032, 64156, 64275, 64389, 64498, 64601, 64700, 64793,
+  64881, 64964, 65041, 65113, 65180, 65241, 65296, 65346, 65390, 65428, 65460, 65487,
+  65508, 65523, 65532, 65535
+};
+
+// FADE_CIE: CIE 1931 lightness, L* = 100x mapped to relative luminance
+static constexpr uint16_t FADE_TABLE_CIE[256] = {
+      0,    28,    57,    85,   114,   142,   171,   199,   228,   256,   285,   313,
+    341,   370,   398,   427,   455,   484,   512,   541,   569,   598,   627,   658,
+    689,   721,   755,   789,   825,   861,   899,   937,   977,  1018,  1060,  1103,
+   1147,  1192,  1239,  1287,  1336,  1386,  1437,  1490,  1544,  1599,  1656,  1714,
+   1773,  1834,  1896,  1959,  2024,  2090,  2157,  2226,  2297,  2369,  2442,  2517,
+   2593,  2671,  2751,  2832,  2914,  2999,  3085,  3172,  3261,  3352,  3444,  3538,
+   3634,  3732,  3831,  3932,  4035,  4139,  4245,  4354,  4464,  4575,  4689,  4804,
+   4922,  5041,  5162,  5285,  5410,  5537,  5666,  5797,  5930,  6065,  6202,  6341,
+   6482,  6626,  6771,  6918,  7068,  7220,  7373,  7529,  7687,  7848,  8010,  8175,
+   8342,  8512,  8683,  8857,  9033,  9212,  9393,  9576,  9762,  9949, 10140, 10333,
+  10528, 10725, 10926, 11128, 11333, 11541, 11751, 11963, 12179, 12396, 12617, 12840,
+  13065, 13293, 13524, 13757, 13993, 14232, 14474, 14718, 14965, 15215, 15467, 15722,
+  15980, 16241, 16505, 16771, 17041, 17313, 17588, 17866, 18147, 18431, 18717, 19007,
+  19300, 19596, 19894, 20196, 20501, 20809, 21119, 21433, 21750, 22071, 22394, 22720,
+  23050, 23383, 23719, 24058, 24400, 24746, 25095, 25447, 25802, 26161, 26523, 26888,
+  27257, 27629, 28004, 28383, 28765, 29151, 29540, 29932, 30328, 30728, 31131, 31537,
+  31947, 32360, 32777, 33198, 33622, 34050, 34481, 34916, 35355, 35797, 36243, 36693,
+  37146, 37603, 38064, 38529, 38997, 39469, 39945, 40425, 40908, 41396, 41887, 42382,
+  42881, 43384, 43891, 44401, 44916, 45435, 45957, 46484, 47015, 47549, 48088, 48631,
+  49178, 49728, 50283, 50843, 51406, 51973, 52545, 53120, 53700, 54284, 54873, 55465,
+  56062, 56663, 57269, 57878, 58492, 59111, 59733, 60360, 60992, 61627, 62268, 62912,
+  63561, 64215, 64873, 65535
+};
+
+#endif // AVANT_PIN_SET_CURVES_H
@@ -0,0 +1,55 @@
+/*
+  AvantPinSetDriver.h - Output driver interface of the AvantPinSet library.
+
+  A driver makes the outputs of an external device, e.g. an I2C PWM controller or GPIO expander,
+  available as virtual pins (see AvantPinSet::attachDriver()). The library only ever buffers
+  values with write() while it works through an operation, and calls flush() once at the end
+  of it, so a driver can send all changes of an update() in one bus transaction.
+*/
+
+#ifndef AVANT_PIN_SET_DRIVER_H
+#define AVANT_PIN_SET_DRIVER_H
+
+#include <stdint.h>
+
+class PinOutputDriver {
+public:
+  virtual ~PinOutputDriver() {}
+
+  /**
+   * @brief Set up the device. Called by AvantPinSet::attachDriver(), after the bus has been started.
+   * @return True if the device answered.
+   */
+  virtual bool begin() = 0;
+
+  /**
+   * @brief Get the number of outputs of the device.
+   */
+  virtual uint8_t channelCount() const = 0;
+
+  /**
+   * @brief Get the resolution of the outputs in bits; 1 for a device that can only switch them.
+   */
+  virtual uint8_t resolution() const = 0;
+
+  /**
+   * @brief Make a channel an output. Output-only devices can leave this empty.
+   * @param channel The channel, 0 to channelCount() - 1.
+   */
+  virtual void setOutput(uint8_t channel) { (void)channel; }
+
+  /**
+   * @brief Buffer a new value for a channel. Nothing is sent to the device before flush().
+   * @param channel The channel, 0 to channelCount() - 1.
+   * @param value The value, 0 (off) to 2^resolution() - 1 (fully on).
+   */
+  virtual void write(uint8_t channel, uint16_t value) = 0;
+
+  /**
+   * @brief Send the buffered changes to the device. Returns at once if nothing changed.
+   * @return True unless the bus reported an error; the changes are then sent again by the next flush().
+   */
+  virtual bool flush() = 0;
+};
+
+#endif // AVANT_PIN_SET_DRIVER_H
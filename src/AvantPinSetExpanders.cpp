@@ -0,0 +1,143 @@
+/*
+  AvantPinSetExpanders.cpp - Output drivers for I2C expanders.
+*/
+
+#include "AvantPinSetExpanders.h"
+
+namespace {
+
+// PCA9685 registers and bits
+const uint8_t PCA9685_MODE1 = 0x00;
+const uint8_t PCA9685_MODE2 = 0x01;
+const uint8_t PCA9685_LED0_ON_L = 0x06; // 4 registers per channel: ON_L, ON_H, OFF_L, OFF_H
+const uint8_t PCA9685_PRE_SCALE = 0xFE;
+const uint8_t PCA9685_MODE1_RESTART = 0x80;
+const uint8_t PCA9685_MODE1_AI = 0x20; // Register auto-increment
+const uint8_t PCA9685_MODE1_SLEEP = 0x10;
+const uint8_t PCA9685_MODE2_OUTDRV = 0x04; // Totem-pole outputs
+const uint16_t PCA9685_FULL = 0x1000;      // Full on / full off bit of the ON_H / OFF_H registers
+const uint16_t PCA9685_MAX = 4095;
+const uint32_t PCA9685_OSCILLATOR_HZ = 25000000UL;
+
+// MCP23017 registers in the power-on bank layout (IOCON.BANK = 0), where the A and B
+// register of each pair are adjacent, so both ports are written in one transaction
+const uint8_t MCP23017_IODIRA = 0x00;
+const uint8_t MCP23017_IOCON = 0x0A;
+const uint8_t MCP23017_OLATA = 0x14;
+
+} // namespace
+
+// --- PCA9685 ---
+PCA9685Driver::PCA9685Driver(uint8_t address, uint16_t pwmFrequency, TwoWire& wire)
+    : _wire(wire), _address(address), _pwmFrequency(pwmFrequency), _changed(0) {
+  memset(_values, 0, sizeof(_values));
+}
+
+bool PCA9685Driver::begin() {
+  uint32_t frequency = constrain(_pwmFrequency, 24, 1526);
+  uint32_t prescale = (PCA9685_OSCILLATOR_HZ + 2048 * frequency) / (4096 * frequency) - 1;
+
+  // The prescaler can only be changed while the oscillator is stopped
+  if (!writeRegister(PCA9685_MODE1, PCA9685_MODE1_SLEEP | PCA9685_MODE1_AI)) return false;
+  if (!writeRegister(PCA9685_PRE_SCALE, (uint8_t)prescale)) return false;
+  if (!writeRegister(PCA9685_MODE2, PCA9685_MODE2_OUTDRV)) return false;
+  if (!writeRegister(PCA9685_MODE1, PCA9685_MODE1_AI)) return false;
+  delayMicroseconds(500); // Oscillator start-up
+  if (!writeRegister(PCA9685_MODE1, PCA9685_MODE1_RESTART | PCA9685_MODE1_AI)) return false;
+
+  // Send every channel once, so the device matches the buffered state
+  _changed = 0xFFFF;
+  return flush();
+}
+
+void PCA9685Driver::write(uint8_t channel, uint16_t value) {
+  if (channel >= 16) return;
+  if (value > PCA9685_MAX) value = PCA9685_MAX;
+  if (_values[channel] == value) return;
+  _values[channel] = value;
+  _changed |= 1U << channel;
+}
+
+bool PCA9685Driver::flush() {
+  if (_changed == 0) return true;
+
+  // One burst covers the changed channels and the unchanged ones between them
+  uint8_t first = (uint8_t)__builtin_ctz(_changed);
+  uint8_t last = (uint8_t)(31 - __builtin_clz(_changed));
+
+  _wire.beginTransmission(_address);
+  _wire.write(PCA9685_LED0_ON_L + 4 * first);
+  for (uint8_t channel = first; channel <= last; channel++) {
+    // The full on / full off bits give clean 0 % and 100 % outputs without a glitch each period
+    uint16_t value = _values[channel];
+    uint16_t on = (value == PCA9685_MAX) ? PCA9685_FULL : 0;
+    uint16_t off = (value == 0) ? PCA9685_FULL : (value == PCA9685_MAX ? 0 : value);
+    _wire.write((uint8_t)on);
+    _wire.write((uint8_t)(on >> 8));
+    _wire.write((uint8_t)off);
+    _wire.write((uint8_t)(off >> 8));
+  }
+  if (_wire.endTransmission() != 0) return false;
+
+  _changed = 0;
+  return true;
+}
+
+bool PCA9685Driver::writeRegister(uint8_t reg, uint8_t value) {
+  _wire.beginTransmission(_address);
+  _wire.write(reg);
+  _wire.write(value);
+  return _wire.endTransmission() == 0;
+}
+
+// --- MCP23017 ---
+MCP23017Driver::MCP23017Driver(uint8_t address, TwoWire& wire)
+    : _wire(wire), _address(address), _latch(0), _direction(0xFFFF), _latchChanged(false), _directionChanged(false) {}
+
+bool MCP23017Driver::begin() {
+  // Back to the power-on register layout and sequential addressing, in case a previous
+  // program changed them without a power cycle
+  _wire.beginTransmission(_address);
+  _wire.write(MCP23017_IOCON);
+  _wire.write((uint8_t)0);
+  if (_wire.endTransmission() != 0) return false;
+
+  _latchChanged = true;
+  _directionChanged = true;
+  return flush();
+}
+
+void MCP23017Driver::setOutput(uint8_t channel) {
+  if (channel >= 16 || !(_direction & (1U << channel))) return;
+  _direction &= ~(1U << channel);
+  _directionChanged = true;
+}
+
+void MCP23017Driver::write(uint8_t channel, uint16_t value) {
+  if (channel >= 16) return;
+  uint16_t latch = value ? (_latch | (1U << channel)) : (_latch & ~(1U << channel));
+  if (latch == _latch) return;
+  _latch = latch;
+  _latchChanged = true;
+}
+
+bool MCP23017Driver::flush() {
+  // Latches first, so a new output starts at its buffered level
+  if (_latchChanged) {
+    if (!writePorts(MCP23017_OLATA, _latch)) return false;
+    _latchChanged = false;
+  }
+  if (_directionChanged) {
+    if (!writePorts(MCP23017_IODIRA, _direction)) return false;
+    _directionChanged = false;
+  }
+  return true;
+}
+
+bool MCP23017Driver::writePorts(uint8_t reg, uint16_t value) {
+  _wire.beginTransmission(_address);
+  _wire.write(reg);
+  _wire.write((uint8_t)value);        // Port A
+  _wire.write((uint8_t)(value >> 8)); // Port B
+  return _wire.endTransmission() == 0;
+}
@@ -0,0 +1,85 @@
+/*
+  AvantPinSetExpanders.h - Output drivers for I2C expanders, for use with AvantPinSet::attachDriver().
+
+  Both drivers keep the state of all outputs and only mark what changed in write(), so flush()
+  sends every change of an update() in a single I2C transaction.
+*/
+
+#ifndef AVANT_PIN_SET_EXPANDERS_H
+#define AVANT_PIN_SET_EXPANDERS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "AvantPinSetDriver.h"
+
+// 16-channel, 12-bit PWM controller. All channels share one PWM frequency.
+class PCA9685Driver : public PinOutputDriver {
+public:
+  /**
+   * @brief Construct a driver for one PCA9685.
+   * @param address The I2C address (0x40 to 0x7F, 0x40 with no address pins tied high).
+   * @param pwmFrequency The PWM frequency of all channels in Hz (24 to 1526).
+   * @param wire The I2C bus, started by the sketch before attachDriver().
+   */
+  explicit PCA9685Driver(uint8_t address = 0x40, uint16_t pwmFrequency = 1000, TwoWire& wire = Wire);
+
+  bool begin() override;
+  uint8_t channelCount() const override { return 16; }
+  uint8_t resolution() const override { return 12; }
+  void write(uint8_t channel, uint16_t value) override;
+
+  /**
+   * @brief Send the changed channels as one burst: the LED register blocks from the lowest to the
+   *        highest changed channel, written with register auto-increment.
+   */
+  bool flush() override;
+
+private:
+  bool writeRegister(uint8_t reg, uint8_t value);
+
+  TwoWire& _wire;
+  uint8_t _address;
+  uint16_t _pwmFrequency;
+  uint16_t _values[16]; // 0 to 4095 per channel
+  uint16_t _changed;    // Bit per channel not yet sent
+};
+
+// 16-bit GPIO expander with two 8-bit ports. Its outputs can only be switched, so a PWM value
+// in the upper half of the pin's range switches the output on.
+class MCP23017Driver : public PinOutputDriver {
+public:
+  /**
+   * @brief Construct a driver for one MCP23017.
+   * @param address The I2C address (0x20 to 0x27).
+   * @param wire The I2C bus, started by the sketch before attachDriver().
+   */
+  explicit MCP23017Driver(uint8_t address = 0x20, TwoWire& wire = Wire);
+
+  bool begin() override;
+  uint8_t channelCount() const override { return 16; }
+  uint8_t resolution() const override { return 1; }
+
+  /**
+   * @brief Make a channel an output. Channels not used as outputs stay inputs.
+   */
+  void setOutput(uint8_t channel) override;
+  void write(uint8_t channel, uint16_t value) override;
+
+  /**
+   * @brief Send the output latches of both ports in one transaction, and the port directions
+   *        in a second one when outputs were added.
+   */
+  bool flush() override;
+
+private:
+  bool writePorts(uint8_t reg, uint16_t value);
+
+  TwoWire& _wire;
+  uint8_t _address;
+  uint16_t _latch;          // Output levels, bit per channel
+  uint16_t _direction;      // Bit per channel, 1 for input (the power-on state)
+  bool _latchChanged;
+  bool _directionChanged;
+};
+
+#endif // AVANT_PIN_SET_EXPANDERS_H
@@ -0,0 +1,114 @@
+/*
+  AvantPinSetHal.h - Hardware access of the AvantPinSet library.
+
+  The library drives pins and reads the scheduler clock only through these functions. On the
+  device they map to the Arduino core. With AVANT_PINSET_HOST defined they are provided by a
+  host backend instead (see extras/host), which keeps a mock clock and records every write,
+  so the scheduler can be built, tested and profiled on a PC.
+*/
+
+#ifndef AVANT_PIN_SET_HAL_H
+#define AVANT_PIN_SET_HAL_H
+
+#include <Arduino.h>
+#include <limits.h>
+#include <stdint.h>
+
+#if defined(ARDUINO_ARCH_ESP32) && !defined(AVANT_PINSET_HOST)
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#endif
+
+namespace AvantPinSetHal {
+
+// Outcome of lightSleep()
+enum SleepWakeup : uint8_t {
+  SLEEP_UNAVAILABLE, // Light sleep is not supported or was refused, no time has passed
+  SLEEP_WOKE_TIMER,  // The requested time is over
+  SLEEP_WOKE_OTHER   // Another wakeup source of the sketch, e.g. a GPIO, ended the sleep early
+};
+
+#if defined(AVANT_PINSET_HOST)
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+void analogWrite(uint8_t pin, int value);
+
+// Scheduler time base in microseconds. 64 bits wide, so deadlines never wrap around.
+uint64_t micros64();
+
+void holdPin(uint8_t pin, bool hold);
+SleepWakeup lightSleep(uint64_t durationUs);
+void delayMicros64(uint64_t durationUs);
+
+#else
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+  ::pinMode(pin, mode);
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+  ::digitalWrite(pin, level);
+}
+
+inline void analogWrite(uint8_t pin, int value) {
+  ::analogWrite(pin, value);
+}
+
+// Scheduler time base in microseconds. 64 bits wide, so deadlines never wrap around.
+inline uint64_t micros64() {
+#if defined(ARDUINO_ARCH_ESP32)
+  return (uint64_t)esp_timer_get_time();
+#else
+  // Extend micros() to 64 bits; it wraps every ~71 minutes, far less often than update() runs
+  static uint32_t lastMicros = 0;
+  static uint32_t wraps = 0;
+  uint32_t now = ::micros();
+  if (now < lastMicros) wraps++;
+  lastMicros = now;
+  return ((uint64_t)wraps << 32) | now;
+#endif
+}
+
+// Latch a pin's output level, so it survives light sleep and ignores writes until released
+inline void holdPin(uint8_t pin, bool hold) {
+#if defined(ARDUINO_ARCH_ESP32)
+  if (hold) {
+    gpio_hold_en((gpio_num_t)pin);
+  } else {
+    gpio_hold_dis((gpio_num_t)pin);
+  }
+#else
+  (void)pin;
+  (void)hold;
+#endif
+}
+
+// Stop the CPUs and most clocks for up to durationUs; the sketch's own wakeup sources stay enabled
+inline SleepWakeup lightSleep(uint64_t durationUs) {
+#if defined(ARDUINO_ARCH_ESP32)
+  if (esp_sleep_enable_timer_wakeup(durationUs) != ESP_OK) return SLEEP_UNAVAILABLE;
+  esp_err_t result = esp_light_sleep_start();
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+  if (result != ESP_OK) return SLEEP_UNAVAILABLE;
+  return (cause == ESP_SLEEP_WAKEUP_TIMER) ? SLEEP_WOKE_TIMER : SLEEP_WOKE_OTHER;
+#else
+  (void)durationUs;
+  return SLEEP_UNAVAILABLE;
+#endif
+}
+
+// Wait without sleeping; delay() lets other tasks run for the whole milliseconds
+inline void delayMicros64(uint64_t durationUs) {
+  uint64_t ms = durationUs / 1000;
+  if (ms > 0) ::delay(ms < ULONG_MAX ? (unsigned long)ms : ULONG_MAX);
+  ::delayMicroseconds((unsigned int)(durationUs % 1000));
+}
+
+#endif
+
+} // namespace AvantPinSetHal
+
+#endif // AVANT_PIN_SET_HAL_H